@@ -0,0 +1,111 @@
+#include <math.h>
+#include "expr_optimizer.h"
+
+/* 判断节点是否为值等于value的常量 */
+static int is_const_value(ExprNode *node, double value) {
+    return node->type == NODE_CONST && node->data.value == value;
+}
+
+/* 用操作节点的一个子节点替换它，释放另一个子节点和操作节点本身 */
+static ExprNode* replace_with_child(ExprNode *node, ExprNode *keep) {
+    ExprNode *drop = keep == node->data.op.left ? node->data.op.right : node->data.op.left;
+    free_expr_tree(drop);
+    free(node);
+    return keep;
+}
+
+/*
+ * 判断1/value是否能精确表示，此时x/value与x*(1/value)的结果逐位相同。
+ * 只有2的整数次幂（且倒数仍是正规数）满足。
+ */
+static int has_exact_reciprocal(double value) {
+    if (!isnormal(value) || !isnormal(1.0 / value)) {
+        return 0;
+    }
+    int exponent;
+    return fabs(frexp(value, &exponent)) == 0.5;
+}
+
+/* 优化表达式树 */
+ExprNode* optimize_expr_tree(ExprNode *node) {
+    if (!node) return NULL;
+    
+    if (!is_op_node(node)) {
+        return node;
+    }
+    
+    // 先优化子树，常量从叶子向上折叠
+    ExprNode *left = optimize_expr_tree(node->data.op.left);
+    ExprNode *right = optimize_expr_tree(node->data.op.right);
+    node->data.op.left = left;
+    node->data.op.right = right;
+    
+    // 比较和逻辑运算只优化子树
+    if (node->type < NODE_ADD || node->type > NODE_DIV) {
+        return node;
+    }
+    
+    // 常量折叠，除数为0时保留原样
+    if (left->type == NODE_CONST && right->type == NODE_CONST &&
+        !(node->type == NODE_DIV && right->data.value == 0.0)) {
+        double a = left->data.value;
+        double b = right->data.value;
+        double value;
+        switch (node->type) {
+            case NODE_ADD:
+                value = a + b;
+                break;
+            case NODE_SUB:
+                value = a - b;
+                break;
+            case NODE_MUL:
+                value = a * b;
+                break;
+            default:
+                value = a / b;
+                break;
+        }
+        free_expr_tree(left);
+        free_expr_tree(right);
+        node->type = NODE_CONST;
+        node->data.value = value;
+        return node;
+    }
+    
+    /*
+     * 恒等运算。x+0在x为-0.0时得到+0.0，不化简；x-(+0.0)对所有x都等于x，
+     * 而x-(-0.0)同样会把-0.0变成+0.0，所以只化简减去+0.0。
+     */
+    switch (node->type) {
+        case NODE_SUB:
+            if (is_const_value(right, 0.0) && !signbit(right->data.value)) {
+                return replace_with_child(node, left);
+            }
+            break;
+        
+        case NODE_MUL:
+            if (is_const_value(right, 1.0)) {
+                return replace_with_child(node, left);
+            }
+            if (is_const_value(left, 1.0)) {
+                return replace_with_child(node, right);
+            }
+            break;
+        
+        case NODE_DIV:
+            if (is_const_value(right, 1.0)) {
+                return replace_with_child(node, left);
+            }
+            // 除以常量改为乘以倒数
+            if (right->type == NODE_CONST && has_exact_reciprocal(right->data.value)) {
+                node->type = NODE_MUL;
+                right->data.value = 1.0 / right->data.value;
+            }
+            break;
+        
+        default:
+            break;
+    }
+    
+    return node;
+}
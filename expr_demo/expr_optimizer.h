@@ -0,0 +1,21 @@
+#ifndef EXPR_OPTIMIZER_H
+#define EXPR_OPTIMIZER_H
+
+#include "expr_tree.h"
+
+/*
+ * 优化表达式树
+ *
+ * 折叠常量子树，消去恒等运算（x-0、x*1、x/1），并把除以2的整数次幂
+ * 改写为乘以它的倒数。只做结果与原表达式逐位相同的变换：x+0不化简为x
+ * （x为-0.0时结果是+0.0），x*0不化简为0（x可能是NaN或无穷大），除数为0的
+ * 常量除法保留到求值时报错。
+ *
+ * 比较和逻辑运算只优化其子树。所有变换都假定double语义（x*1会化简为x，改变整数
+ * 变量参与运算时的结果类型），因此不要在compile_tree_to_typed之前使用。
+ *
+ * 直接修改传入的树，被消去的节点会被释放；返回优化后的根节点。
+ */
+ExprNode* optimize_expr_tree(ExprNode *node);
+
+#endif /* EXPR_OPTIMIZER_H */
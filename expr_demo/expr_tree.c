@@ -25,7 +25,42 @@ ExprNode* create_var_node(const char *name) {
     return node;
 }
 
-/* 创建操作节点 */
+/* 创建整数常量节点 */
+ExprNode* create_int_const_node(int64_t value) {
+    ExprNode *node = (ExprNode*)malloc(sizeof(ExprNode));
+    if (!node) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    node->type = NODE_INT_CONST;
+    node->data.int_value = value;
+    return node;
+}
+
+/* 创建布尔常量节点 */
+ExprNode* create_bool_const_node(int value) {
+    ExprNode *node = (ExprNode*)malloc(sizeof(ExprNode));
+    if (!node) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    node->type = NODE_BOOL_CONST;
+    node->data.bool_value = value != 0;
+    return node;
+}
+
+/* 创建NULL常量节点 */
+ExprNode* create_null_node(void) {
+    ExprNode *node = (ExprNode*)malloc(sizeof(ExprNode));
+    if (!node) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    node->type = NODE_NULL;
+    return node;
+}
+
+/* 创建操作节点（算术运算、比较或逻辑运算） */
 ExprNode* create_op_node(NodeType type, ExprNode *left, ExprNode *right) {
     ExprNode *node = (ExprNode*)malloc(sizeof(ExprNode));
     if (!node) {
@@ -38,12 +73,36 @@ ExprNode* create_op_node(NodeType type, ExprNode *left, ExprNode *right) {
     return node;
 }
 
+/* 判断节点是否为有两个子节点的操作节点 */
+int is_op_node(ExprNode *node) {
+    return (node->type >= NODE_ADD && node->type <= NODE_DIV) ||
+           (node->type >= NODE_LT && node->type <= NODE_OR);
+}
+
+/* 复制表达式树 */
+ExprNode* copy_expr_tree(ExprNode *node) {
+    if (!node) return NULL;
+    
+    ExprNode *copy = (ExprNode*)malloc(sizeof(ExprNode));
+    if (!copy) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    *copy = *node;
+    
+    if (is_op_node(node)) {
+        copy->data.op.left = copy_expr_tree(node->data.op.left);
+        copy->data.op.right = copy_expr_tree(node->data.op.right);
+    }
+    
+    return copy;
+}
+
 /* 释放表达式树 */
 void free_expr_tree(ExprNode *node) {
     if (!node) return;
     
-    if (node->type == NODE_ADD || node->type == NODE_SUB || 
-        node->type == NODE_MUL || node->type == NODE_DIV) {
+    if (is_op_node(node)) {
         free_expr_tree(node->data.op.left);
         free_expr_tree(node->data.op.right);
     }
@@ -59,6 +118,15 @@ void print_expr_tree(ExprNode *node) {
         case NODE_CONST:
             printf("%.2f", node->data.value);
             break;
+        case NODE_INT_CONST:
+            printf("%lld", (long long)node->data.int_value);
+            break;
+        case NODE_BOOL_CONST:
+            printf("%s", node->data.bool_value ? "true" : "false");
+            break;
+        case NODE_NULL:
+            printf("NULL");
+            break;
         case NODE_VAR:
             printf("%s", node->data.var_name);
             break;
@@ -90,6 +158,28 @@ void print_expr_tree(ExprNode *node) {
             print_expr_tree(node->data.op.right);
             printf(")");
             break;
+        case NODE_LT:
+        case NODE_LE:
+        case NODE_GT:
+        case NODE_GE:
+        case NODE_EQ:
+        case NODE_NE: {
+            static const char *const symbols[] = {" < ", " <= ", " > ", " >= ", " = ", " <> "};
+            printf("(");
+            print_expr_tree(node->data.op.left);
+            printf("%s", symbols[node->type - NODE_LT]);
+            print_expr_tree(node->data.op.right);
+            printf(")");
+            break;
+        }
+        case NODE_AND:
+        case NODE_OR:
+            printf("(");
+            print_expr_tree(node->data.op.left);
+            printf(node->type == NODE_AND ? " AND " : " OR ");
+            print_expr_tree(node->data.op.right);
+            printf(")");
+            break;
     }
 }
 
@@ -101,54 +191,154 @@ Context* create_context(int var_count) {
         exit(1);
     }
     
-    ctx->vars = (Variable*)malloc(sizeof(Variable) * var_count);
-    if (!ctx->vars) {
+    ctx->names = (char (*)[16])malloc(sizeof(*ctx->names) * var_count);
+    ctx->values = (double*)malloc(sizeof(double) * var_count);
+    ctx->ints = (int64_t*)malloc(sizeof(int64_t) * var_count);
+    ctx->types = (ValueType*)malloc(sizeof(ValueType) * var_count);
+    ctx->nulls = (unsigned char*)malloc(var_count);
+    if (!ctx->names || !ctx->values || !ctx->ints || !ctx->types || !ctx->nulls) {
         fprintf(stderr, "内存分配失败\n");
+        free(ctx->names);
+        free(ctx->values);
+        if (ctx->ints) {
+            free(ctx->ints);
+        }
+        if (ctx->types) {
+            free(ctx->types);
+        }
+        if (ctx->nulls) {
+            free(ctx->nulls);
+        }
         free(ctx);
         exit(1);
     }
     
-    ctx->var_count = var_count;
-    for (int i = 0; i < var_count; i++) {
-        ctx->vars[i].name[0] = '\0';
-        ctx->vars[i].value = 0.0;
-    }
+    ctx->var_count = 0;
+    ctx->capacity = var_count;
     
     return ctx;
 }
 
-/* 设置变量值 */
-void set_variable(Context *ctx, const char *name, double value) {
+/* 查找变量的槽位，不存在时返回-1 */
+int find_variable_slot(Context *ctx, const char *name) {
     for (int i = 0; i < ctx->var_count; i++) {
-        if (ctx->vars[i].name[0] == '\0') {
-            strncpy(ctx->vars[i].name, name, 15);
-            ctx->vars[i].name[15] = '\0';
-            ctx->vars[i].value = value;
-            return;
-        } else if (strcmp(ctx->vars[i].name, name) == 0) {
-            ctx->vars[i].value = value;
-            return;
+        if (strcmp(ctx->names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* 分配新槽位，初值为double类型的0.0；空间已满时返回-1 */
+static int add_variable_slot(Context *ctx, const char *name) {
+    if (ctx->var_count >= ctx->capacity) {
+        return -1;
+    }
+    
+    int slot = ctx->var_count++;
+    strncpy(ctx->names[slot], name, 15);
+    ctx->names[slot][15] = '\0';
+    ctx->values[slot] = 0.0;
+    ctx->ints[slot] = 0;
+    ctx->types[slot] = TYPE_DOUBLE;
+    ctx->nulls[slot] = 0;
+    return slot;
+}
+
+/* 查找或分配变量的槽位，空间已满时报错并返回-1 */
+static int variable_slot_for_set(Context *ctx, const char *name) {
+    int slot = find_variable_slot(ctx, name);
+    if (slot < 0) {
+        slot = add_variable_slot(ctx, name);
+        if (slot < 0) {
+            fprintf(stderr, "变量空间已满或变量'%s'不存在\n", name);
         }
     }
-    fprintf(stderr, "变量空间已满或变量'%s'不存在\n", name);
+    return slot;
+}
+
+/* 设置变量值 */
+void set_variable(Context *ctx, const char *name, double value) {
+    int slot = variable_slot_for_set(ctx, name);
+    if (slot >= 0) {
+        ctx->values[slot] = value;
+        ctx->types[slot] = TYPE_DOUBLE;
+        ctx->nulls[slot] = 0;
+    }
+}
+
+/* 设置整数变量值 */
+void set_int_variable(Context *ctx, const char *name, int64_t value) {
+    int slot = variable_slot_for_set(ctx, name);
+    if (slot >= 0) {
+        ctx->ints[slot] = value;
+        ctx->values[slot] = (double)value;
+        ctx->types[slot] = TYPE_INT64;
+        ctx->nulls[slot] = 0;
+    }
+}
+
+/* 设置布尔变量值 */
+void set_bool_variable(Context *ctx, const char *name, int value) {
+    int slot = variable_slot_for_set(ctx, name);
+    if (slot >= 0) {
+        ctx->ints[slot] = value != 0;
+        ctx->values[slot] = value != 0 ? 1.0 : 0.0;
+        ctx->types[slot] = TYPE_BOOL;
+        ctx->nulls[slot] = 0;
+    }
+}
+
+/* 把变量设为NULL，变量不存在时创建一个double类型的变量 */
+void set_null_variable(Context *ctx, const char *name) {
+    int slot = variable_slot_for_set(ctx, name);
+    if (slot >= 0) {
+        ctx->values[slot] = 0.0;
+        ctx->ints[slot] = 0;
+        ctx->nulls[slot] = 1;
+    }
 }
 
 /* 获取变量值 */
 double get_variable(Context *ctx, const char *name) {
-    for (int i = 0; i < ctx->var_count; i++) {
-        if (strcmp(ctx->vars[i].name, name) == 0) {
-            return ctx->vars[i].value;
+    int slot = find_variable_slot(ctx, name);
+    if (slot < 0) {
+        fprintf(stderr, "变量'%s'不存在\n", name);
+        return 0.0;
+    }
+    return ctx->values[slot];
+}
+
+/* 绑定变量到槽位，变量不存在时以0.0为初值分配新槽位 */
+int bind_variable_slot(Context *ctx, const char *name) {
+    int slot = find_variable_slot(ctx, name);
+    if (slot < 0) {
+        slot = add_variable_slot(ctx, name);
+        if (slot < 0) {
+            fprintf(stderr, "变量空间已满，无法绑定变量'%s'\n", name);
+            exit(1);
         }
     }
-    fprintf(stderr, "变量'%s'不存在\n", name);
-    return 0.0;
+    return slot;
 }
 
 /* 释放上下文 */
 void free_context(Context *ctx) {
     if (ctx) {
-        if (ctx->vars) {
-            free(ctx->vars);
+        if (ctx->names) {
+            free(ctx->names);
+        }
+        if (ctx->values) {
+            free(ctx->values);
+        }
+        if (ctx->ints) {
+            free(ctx->ints);
+        }
+        if (ctx->types) {
+            free(ctx->types);
+        }
+        if (ctx->nulls) {
+            free(ctx->nulls);
         }
         free(ctx);
     }
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <time.h>
 
 /* 表达式节点类型 */
@@ -13,7 +14,18 @@ typedef enum {
     NODE_ADD,      // 加法
     NODE_SUB,      // 减法
     NODE_MUL,      // 乘法
-    NODE_DIV       // 除法
+    NODE_DIV,      // 除法
+    NODE_INT_CONST,   // 整数常量
+    NODE_BOOL_CONST,  // 布尔常量
+    NODE_NULL,        // NULL常量
+    NODE_LT,       // 小于
+    NODE_LE,       // 小于等于
+    NODE_GT,       // 大于
+    NODE_GE,       // 大于等于
+    NODE_EQ,       // 等于
+    NODE_NE,       // 不等于
+    NODE_AND,      // 逻辑与（SQL三值逻辑）
+    NODE_OR        // 逻辑或（SQL三值逻辑）
 } NodeType;
 
 /* 表达式树节点 */
@@ -21,6 +33,8 @@ typedef struct ExprNode {
     NodeType type;
     union {
         double value;      // 常量值
+        int64_t int_value; // 整数常量值
+        int bool_value;    // 布尔常量值
         char var_name[16]; // 变量名
         struct {
             struct ExprNode *left;
@@ -29,15 +43,41 @@ typedef struct ExprNode {
     } data;
 } ExprNode;
 
-/* 变量上下文 */
+/* 值类型 */
+typedef enum {
+    TYPE_DOUBLE,   // 双精度浮点数
+    TYPE_INT64,    // 64位整数
+    TYPE_BOOL      // 布尔值
+} ValueType;
+
+/* 带类型的值，按SQL语义可以为NULL */
 typedef struct {
-    char name[16];
-    double value;
-} Variable;
+    union {
+        double d;
+        int64_t i;
+        int b;
+    } data;
+    int is_null;
+} Value;
 
+/*
+ * 变量上下文
+ *
+ * 每个变量占一个槽位，变量值按槽位存放在稠密数组values中。编译时把变量名
+ * 解析为槽位号，求值时只需一次下标访问 values[slot]。
+ *
+ * 每个槽位还有类型和NULL标记，供带类型的求值器使用。整数和布尔变量的值
+ * 存放在ints中，同时以double写入values，只支持double的求值器按double
+ * 读取它们，并把NULL当作0.0。
+ */
 typedef struct {
-    Variable *vars;
-    int var_count;
+    char (*names)[16];     // 变量名，按槽位排列
+    double *values;        // 变量值，按槽位排列
+    int64_t *ints;         // 整数和布尔变量的值
+    ValueType *types;      // 变量类型
+    unsigned char *nulls;  // 变量是否为NULL
+    int var_count;         // 已使用的槽位数
+    int capacity;          // 槽位总数
 } Context;
 
 /* 创建常量节点 */
@@ -46,9 +86,24 @@ ExprNode* create_const_node(double value);
 /* 创建变量节点 */
 ExprNode* create_var_node(const char *name);
 
-/* 创建操作节点 */
+/* 创建整数常量节点 */
+ExprNode* create_int_const_node(int64_t value);
+
+/* 创建布尔常量节点 */
+ExprNode* create_bool_const_node(int value);
+
+/* 创建NULL常量节点 */
+ExprNode* create_null_node(void);
+
+/* 创建操作节点（算术运算或比较） */
 ExprNode* create_op_node(NodeType type, ExprNode *left, ExprNode *right);
 
+/* 判断节点是否为有两个子节点的操作节点 */
+int is_op_node(ExprNode *node);
+
+/* 复制表达式树 */
+ExprNode* copy_expr_tree(ExprNode *node);
+
 /* 释放表达式树 */
 void free_expr_tree(ExprNode *node);
 
@@ -61,9 +116,24 @@ Context* create_context(int var_count);
 /* 设置变量值 */
 void set_variable(Context *ctx, const char *name, double value);
 
+/* 设置整数变量值 */
+void set_int_variable(Context *ctx, const char *name, int64_t value);
+
+/* 设置布尔变量值 */
+void set_bool_variable(Context *ctx, const char *name, int value);
+
+/* 把变量设为NULL，变量不存在时创建一个double类型的变量 */
+void set_null_variable(Context *ctx, const char *name);
+
 /* 获取变量值 */
 double get_variable(Context *ctx, const char *name);
 
+/* 查找变量的槽位，不存在时返回-1 */
+int find_variable_slot(Context *ctx, const char *name);
+
+/* 绑定变量到槽位，变量不存在时以0.0为初值分配新槽位 */
+int bind_variable_slot(Context *ctx, const char *name);
+
 /* 释放上下文 */
 void free_context(Context *ctx);
 
@@ -1,5 +1,63 @@
 #include "flat_evaluator.h"
 
+#ifdef FLAT_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+/* 当前的周期数 */
+static inline unsigned long long flat_profile_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * 每条指令开始时读一次时钟，与上一次读数的差扣除读时钟本身的开销后记到
+ * 上一条指令名下，因此每条指令只多一次读时钟
+ */
+/* 把一段时间记到指令名下 */
+static inline void flat_profile_add(FlatProfile *profile, int index, unsigned long long delta) {
+    profile->cycles[index] += delta > profile->overhead ? delta - profile->overhead : 0;
+}
+
+#define FLAT_PROFILE_BEGIN(flat_expr) \
+    FlatProfile *profile = (flat_expr)->profile; \
+    int profile_prev = -1; \
+    unsigned long long profile_start = 0
+
+#define FLAT_PROFILE_STEP(index, rows) \
+    do { \
+        if (profile) { \
+            unsigned long long profile_now = flat_profile_clock(); \
+            if (profile_prev >= 0) { \
+                flat_profile_add(profile, profile_prev, profile_now - profile_start); \
+            } \
+            profile->counts[index] += (rows); \
+            profile_prev = (index); \
+            profile_start = profile_now; \
+        } \
+    } while (0)
+
+#define FLAT_PROFILE_END() \
+    do { \
+        if (profile && profile_prev >= 0) { \
+            flat_profile_add(profile, profile_prev, flat_profile_clock() - profile_start); \
+            profile_prev = -1; \
+        } \
+    } while (0)
+#else
+#define FLAT_PROFILE_BEGIN(flat_expr)
+#define FLAT_PROFILE_STEP(index, rows)
+#define FLAT_PROFILE_END()
+#endif /* FLAT_PROFILE */
+
 /* 创建扁平化表达式 */
 FlatExpr* create_flat_expr(int initial_capacity) {
     FlatExpr *flat_expr = (FlatExpr*)malloc(sizeof(FlatExpr));
@@ -17,6 +75,10 @@ FlatExpr* create_flat_expr(int initial_capacity) {
     
     flat_expr->count = 0;
     flat_expr->capacity = initial_capacity;
+    flat_expr->temp_count = 0;
+#ifdef FLAT_PROFILE
+    flat_expr->profile = NULL;
+#endif
     
     return flat_expr;
 }
@@ -37,8 +99,8 @@ static void add_instruction(FlatExpr *flat_expr, Instruction instr) {
     flat_expr->instructions[flat_expr->count++] = instr;
 }
 
-/* 将表达式树编译为扁平化表达式 */
-void compile_tree_to_flat(ExprNode *node, FlatExpr *flat_expr) {
+/* 将表达式树编译为扁平化表达式，变量在编译时绑定到ctx中的槽位 */
+void compile_tree_to_flat(ExprNode *node, FlatExpr *flat_expr, Context *ctx) {
     if (!node) return;
     
     Instruction instr;
@@ -46,8 +108,8 @@ void compile_tree_to_flat(ExprNode *node, FlatExpr *flat_expr) {
     // 后序遍历，先处理左右子树，再处理当前节点
     if (node->type == NODE_ADD || node->type == NODE_SUB || 
         node->type == NODE_MUL || node->type == NODE_DIV) {
-        compile_tree_to_flat(node->data.op.left, flat_expr);
-        compile_tree_to_flat(node->data.op.right, flat_expr);
+        compile_tree_to_flat(node->data.op.left, flat_expr, ctx);
+        compile_tree_to_flat(node->data.op.right, flat_expr, ctx);
         
         // 添加操作指令
         switch (node->type) {
@@ -73,26 +135,228 @@ void compile_tree_to_flat(ExprNode *node, FlatExpr *flat_expr) {
         instr.data.value = node->data.value;
         add_instruction(flat_expr, instr);
     } else if (node->type == NODE_VAR) {
-        // 添加变量加载指令
+        // 添加变量加载指令，变量名在这里一次性解析为槽位
         instr.op = OP_LOAD_VAR;
-        strncpy(instr.data.var_name, node->data.var_name, 15);
-        instr.data.var_name[15] = '\0';
+        instr.data.slot = bind_variable_slot(ctx, node->data.var_name);
         add_instruction(flat_expr, instr);
+    } else {
+        // 整数、布尔、NULL和比较只能由带类型的求值器处理
+        fprintf(stderr, "未知节点类型\n");
+        exit(1);
     }
 }
 
-/* 基于扁平数组的表达式计算 */
-double evaluate_flat(FlatExpr *flat_expr, Context *ctx) {
+/* DAG节点，每个节点代表一个不同的子表达式 */
+typedef struct {
+    NodeType type;
+    double value;          // 常量值
+    int slot;              // 变量槽位
+    int left;              // 运算节点左右操作数的DAG编号
+    int right;
+    int refs;              // 被其他DAG节点引用的次数
+    int temp;              // 分配的临时槽位，-1表示不保存
+    int emitted;           // 是否已经生成过计算它的指令
+} DagNode;
+
+/* 构造DAG时的状态 */
+typedef struct {
+    DagNode *nodes;
+    int count;
+    int *table;            // 开放寻址哈希表，存放DAG节点编号，-1表示空
+    int table_mask;
+} DagBuilder;
+
+/* 统计表达式树的节点数 */
+static int count_tree_nodes(ExprNode *node) {
+    if (is_op_node(node)) {
+        return 1 + count_tree_nodes(node->data.op.left) + count_tree_nodes(node->data.op.right);
+    }
+    return 1;
+}
+
+static unsigned long long dag_hash(DagNode *node) {
+    unsigned long long bits;
+    memcpy(&bits, &node->value, sizeof(bits));
+    unsigned long long h = (unsigned long long)node->type;
+    h = h * 0x9E3779B97F4A7C15ULL ^ bits;
+    h = h * 0x9E3779B97F4A7C15ULL ^ (unsigned int)node->slot;
+    h = h * 0x9E3779B97F4A7C15ULL ^ (unsigned int)node->left;
+    h = h * 0x9E3779B97F4A7C15ULL ^ (unsigned int)node->right;
+    return h ^ (h >> 29);
+}
+
+/* 常量按位比较，-0.0与0.0是不同的常量 */
+static int dag_equal(DagNode *a, DagNode *b) {
+    return a->type == b->type &&
+           memcmp(&a->value, &b->value, sizeof(double)) == 0 &&
+           a->slot == b->slot && a->left == b->left && a->right == b->right;
+}
+
+/* 查找与key相同的DAG节点，不存在时加入；返回节点编号 */
+static int dag_intern(DagBuilder *builder, DagNode *key) {
+    unsigned long long pos = dag_hash(key) & builder->table_mask;
+    while (builder->table[pos] >= 0) {
+        if (dag_equal(&builder->nodes[builder->table[pos]], key)) {
+            return builder->table[pos];
+        }
+        pos = (pos + 1) & builder->table_mask;
+    }
+    
+    builder->table[pos] = builder->count;
+    builder->nodes[builder->count] = *key;
+    return builder->count++;
+}
+
+/* 把表达式树合并进DAG，返回根节点的编号 */
+static int dag_build(DagBuilder *builder, ExprNode *node, Context *ctx) {
+    DagNode key;
+    memset(&key, 0, sizeof(key));
+    key.type = node->type;
+    key.temp = -1;
+    
+    switch (node->type) {
+        case NODE_CONST:
+            key.value = node->data.value;
+            break;
+            
+        case NODE_VAR:
+            key.slot = bind_variable_slot(ctx, node->data.var_name);
+            break;
+            
+        case NODE_ADD:
+        case NODE_SUB:
+        case NODE_MUL:
+        case NODE_DIV:
+            key.left = dag_build(builder, node->data.op.left, ctx);
+            key.right = dag_build(builder, node->data.op.right, ctx);
+            // 浮点加法和乘法满足交换律，a+b与b+a是同一个子表达式
+            if ((node->type == NODE_ADD || node->type == NODE_MUL) && key.left > key.right) {
+                int tmp = key.left;
+                key.left = key.right;
+                key.right = tmp;
+            }
+            break;
+            
+        default:
+            fprintf(stderr, "未知节点类型\n");
+            exit(1);
+    }
+    
+    return dag_intern(builder, &key);
+}
+
+/* 生成计算DAG节点的指令，共享节点第二次出现时直接读取临时槽位 */
+static void dag_emit(DagBuilder *builder, FlatExpr *flat_expr, int id) {
+    DagNode *node = &builder->nodes[id];
+    Instruction instr;
+    
+    if (node->temp >= 0 && node->emitted) {
+        instr.op = OP_LOAD_TEMP;
+        instr.data.slot = node->temp;
+        add_instruction(flat_expr, instr);
+        return;
+    }
+    
+    switch (node->type) {
+        case NODE_CONST:
+            instr.op = OP_LOAD_CONST;
+            instr.data.value = node->value;
+            break;
+            
+        case NODE_VAR:
+            instr.op = OP_LOAD_VAR;
+            instr.data.slot = node->slot;
+            break;
+            
+        default:
+            dag_emit(builder, flat_expr, node->left);
+            dag_emit(builder, flat_expr, node->right);
+            switch (node->type) {
+                case NODE_ADD:
+                    instr.op = OP_ADD;
+                    break;
+                case NODE_SUB:
+                    instr.op = OP_SUB;
+                    break;
+                case NODE_MUL:
+                    instr.op = OP_MUL;
+                    break;
+                default:
+                    instr.op = OP_DIV;
+                    break;
+            }
+            break;
+    }
+    add_instruction(flat_expr, instr);
+    
+    if (node->temp >= 0) {
+        instr.op = OP_STORE_TEMP;
+        instr.data.slot = node->temp;
+        add_instruction(flat_expr, instr);
+        node->emitted = 1;
+    }
+}
+
+/* 消除公共子表达式后编译为扁平化表达式 */
+void compile_tree_to_flat_cse(ExprNode *node, FlatExpr *flat_expr, Context *ctx) {
+    if (!node) return;
+    
+    int tree_nodes = count_tree_nodes(node);
+    int table_size = 1;
+    while (table_size < tree_nodes * 2) {
+        table_size <<= 1;
+    }
+    
+    DagBuilder builder;
+    builder.nodes = (DagNode*)malloc(sizeof(DagNode) * tree_nodes);
+    builder.table = (int*)malloc(sizeof(int) * table_size);
+    if (!builder.nodes || !builder.table) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    builder.count = 0;
+    builder.table_mask = table_size - 1;
+    memset(builder.table, -1, sizeof(int) * table_size);
+    
+    int root = dag_build(&builder, node, ctx);
+    
+    // 被引用多次的运算节点分配临时槽位；变量和常量重新加载的代价与读临时槽位相同
+    for (int i = 0; i < builder.count; i++) {
+        if (builder.nodes[i].type != NODE_CONST && builder.nodes[i].type != NODE_VAR) {
+            builder.nodes[builder.nodes[i].left].refs++;
+            builder.nodes[builder.nodes[i].right].refs++;
+        }
+    }
+    for (int i = 0; i < builder.count; i++) {
+        DagNode *dag_node = &builder.nodes[i];
+        if (dag_node->type != NODE_CONST && dag_node->type != NODE_VAR &&
+            dag_node->refs >= 2 && flat_expr->temp_count < FLAT_MAX_TEMPS) {
+            dag_node->temp = flat_expr->temp_count++;
+        }
+    }
+    
+    dag_emit(&builder, flat_expr, root);
+    
+    free(builder.nodes);
+    free(builder.table);
+}
+
+/* 基于扁平数组的表达式计算，总是使用switch分派 */
+double evaluate_flat_switch(FlatExpr *flat_expr, Context *ctx) {
     if (!flat_expr || flat_expr->count == 0) {
         return 0.0;
     }
     
     // 使用栈来存储中间结果
     double stack[1000];
+    const double *vars = ctx->values;
     int stack_top = -1;
+    double temps[FLAT_MAX_TEMPS];
+    FLAT_PROFILE_BEGIN(flat_expr);
     
     for (int i = 0; i < flat_expr->count; i++) {
         Instruction *instr = &flat_expr->instructions[i];
+        FLAT_PROFILE_STEP(i, 1);
         
         switch (instr->op) {
             case OP_LOAD_CONST:
@@ -100,7 +364,15 @@ double evaluate_flat(FlatExpr *flat_expr, Context *ctx) {
                 break;
                 
             case OP_LOAD_VAR:
-                stack[++stack_top] = get_variable(ctx, instr->data.var_name);
+                stack[++stack_top] = vars[instr->data.slot];
+                break;
+                
+            case OP_STORE_TEMP:
+                temps[instr->data.slot] = stack[stack_top];
+                break;
+                
+            case OP_LOAD_TEMP:
+                stack[++stack_top] = temps[instr->data.slot];
                 break;
                 
             case OP_ADD: {
@@ -109,24 +381,25 @@ double evaluate_flat(FlatExpr *flat_expr, Context *ctx) {
                 stack[++stack_top] = a + b;
                 break;
             }
-                
+            
             case OP_SUB: {
                 double b = stack[stack_top--];
                 double a = stack[stack_top--];
                 stack[++stack_top] = a - b;
                 break;
             }
-                
+            
             case OP_MUL: {
                 double b = stack[stack_top--];
                 double a = stack[stack_top--];
                 stack[++stack_top] = a * b;
                 break;
             }
-                
+            
             case OP_DIV: {
                 double b = stack[stack_top--];
                 if (b == 0.0) {
+                    FLAT_PROFILE_END();
                     fprintf(stderr, "除零错误\n");
                     return 0.0;
                 }
@@ -136,6 +409,7 @@ double evaluate_flat(FlatExpr *flat_expr, Context *ctx) {
             }
         }
     }
+    FLAT_PROFILE_END();
     
     // 栈顶元素应该是最终结果
     if (stack_top != 0) {
@@ -146,50 +420,456 @@ double evaluate_flat(FlatExpr *flat_expr, Context *ctx) {
     return stack[stack_top];
 }
 
+/* 计算指令序列需要的栈深度，栈不平衡时返回-1 */
+int flat_expr_stack_depth(FlatExpr *flat_expr) {
+    int depth = 0;
+    int max_depth = 0;
+    
+    for (int i = 0; i < flat_expr->count; i++) {
+        OpCode op = flat_expr->instructions[i].op;
+        if (op == OP_LOAD_CONST || op == OP_LOAD_VAR || op == OP_LOAD_TEMP) {
+            depth++;
+            if (depth > max_depth) {
+                max_depth = depth;
+            }
+        } else if (op == OP_STORE_TEMP) {
+            if (depth < 1) {
+                return -1;
+            }
+        } else if (depth < 2) {
+            return -1;
+        } else {
+            depth--;
+        }
+    }
+    
+    return depth == 1 ? max_depth : -1;
+}
+
+/*
+ * 批量求值的运算核心
+ *
+ * 每次处理整批FLAT_BATCH_SIZE行，输出与输入互不重叠（restrict），循环体
+ * 没有分支，编译器在-O2下就能把它们向量化。
+ */
+static void batch_add(double *restrict out, const double *restrict a,
+                      const double *restrict b) {
+    for (int i = 0; i < FLAT_BATCH_SIZE; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+static void batch_sub(double *restrict out, const double *restrict a,
+                      const double *restrict b) {
+    for (int i = 0; i < FLAT_BATCH_SIZE; i++) {
+        out[i] = a[i] - b[i];
+    }
+}
+
+static void batch_mul(double *restrict out, const double *restrict a,
+                      const double *restrict b) {
+    for (int i = 0; i < FLAT_BATCH_SIZE; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+/* 除法先照常计算，再把除数为零的行记入zero，最后统一把这些行的结果置为0.0 */
+static void batch_div(double *restrict out, const double *restrict a,
+                      const double *restrict b, unsigned char *restrict zero) {
+    for (int i = 0; i < FLAT_BATCH_SIZE; i++) {
+        out[i] = a[i] / b[i];
+    }
+    for (int i = 0; i < FLAT_BATCH_SIZE; i++) {
+        zero[i] |= (b[i] == 0.0);
+    }
+}
+
+/* 批量计算count行的表达式值 */
+void evaluate_flat_batch(FlatExpr *flat_expr, const double *const *columns,
+                         int count, double *results) {
+    if (!flat_expr || flat_expr->count == 0) {
+        memset(results, 0, sizeof(double) * count);
+        return;
+    }
+    
+    int depth = flat_expr_stack_depth(flat_expr);
+    if (depth < 0) {
+        fprintf(stderr, "表达式计算错误，栈不平衡\n");
+        memset(results, 0, sizeof(double) * count);
+        return;
+    }
+    
+    /*
+     * 栈的每一层是一批行的值。变量直接指向列数据，常量指向预先填充好的
+     * 常量行，都不复制；运算结果写入该层的缓冲区。每层有两个缓冲区，运算
+     * 结果写入左操作数没有占用的那个，保证输出与输入不重叠。临时槽位的值
+     * 复制到各自的缓冲区，不会被后面的运算覆盖。
+     */
+    double *buffers = (double*)malloc(sizeof(double) * FLAT_BATCH_SIZE * 2 * depth);
+    const double **stack = (const double**)malloc(sizeof(double*) * depth);
+    double *temp_rows = NULL;
+    if (flat_expr->temp_count > 0) {
+        temp_rows = (double*)malloc(sizeof(double) * FLAT_BATCH_SIZE * flat_expr->temp_count);
+        if (!temp_rows) {
+            fprintf(stderr, "内存分配失败\n");
+            exit(1);
+        }
+    }
+    
+    // 常量在所有批次中不变，每个常量指令的整批值只填充一次
+    double **const_rows = (double**)calloc(flat_expr->count, sizeof(double*));
+    if (!buffers || !stack || !const_rows) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    for (int i = 0; i < flat_expr->count; i++) {
+        if (flat_expr->instructions[i].op == OP_LOAD_CONST) {
+            const_rows[i] = (double*)malloc(sizeof(double) * FLAT_BATCH_SIZE);
+            if (!const_rows[i]) {
+                fprintf(stderr, "内存分配失败\n");
+                exit(1);
+            }
+            for (int j = 0; j < FLAT_BATCH_SIZE; j++) {
+                const_rows[i][j] = flat_expr->instructions[i].data.value;
+            }
+        }
+    }
+    
+    unsigned char zero[FLAT_BATCH_SIZE];
+    int zero_rows = 0;
+    FLAT_PROFILE_BEGIN(flat_expr);
+    
+    for (int base = 0; base < count; base += FLAT_BATCH_SIZE) {
+        int n = count - base < FLAT_BATCH_SIZE ? count - base : FLAT_BATCH_SIZE;
+        int stack_top = -1;
+        memset(zero, 0, sizeof(zero));
+        
+        for (int i = 0; i < flat_expr->count; i++) {
+            Instruction *instr = &flat_expr->instructions[i];
+            FLAT_PROFILE_STEP(i, n);
+            
+            switch (instr->op) {
+                case OP_LOAD_CONST:
+                    stack[++stack_top] = const_rows[i];
+                    break;
+                    
+                case OP_LOAD_VAR:
+                    if (n == FLAT_BATCH_SIZE) {
+                        stack[++stack_top] = columns[instr->data.slot] + base;
+                    } else {
+                        // 最后不满一批时把列复制到缓冲区并补零，运算核心总是处理整批
+                        double *out = buffers + (size_t)(stack_top + 1) * 2 * FLAT_BATCH_SIZE;
+                        memcpy(out, columns[instr->data.slot] + base, sizeof(double) * n);
+                        memset(out + n, 0, sizeof(double) * (FLAT_BATCH_SIZE - n));
+                        stack[++stack_top] = out;
+                    }
+                    break;
+                    
+                case OP_STORE_TEMP:
+                    memcpy(temp_rows + (size_t)instr->data.slot * FLAT_BATCH_SIZE,
+                           stack[stack_top], sizeof(double) * FLAT_BATCH_SIZE);
+                    break;
+                    
+                case OP_LOAD_TEMP:
+                    stack[++stack_top] = temp_rows + (size_t)instr->data.slot * FLAT_BATCH_SIZE;
+                    break;
+                    
+                default: {
+                    const double *b = stack[stack_top--];
+                    const double *a = stack[stack_top];
+                    double *out = buffers + (size_t)stack_top * 2 * FLAT_BATCH_SIZE;
+                    if (a == out) {
+                        out += FLAT_BATCH_SIZE;
+                    }
+                    
+                    switch (instr->op) {
+                        case OP_ADD:
+                            batch_add(out, a, b);
+                            break;
+                        case OP_SUB:
+                            batch_sub(out, a, b);
+                            break;
+                        case OP_MUL:
+                            batch_mul(out, a, b);
+                            break;
+                        default:
+                            batch_div(out, a, b, zero);
+                            break;
+                    }
+                    stack[stack_top] = out;
+                    break;
+                }
+            }
+        }
+        FLAT_PROFILE_END();
+        
+        const double *top = stack[0];
+        for (int j = 0; j < n; j++) {
+            results[base + j] = zero[j] ? 0.0 : top[j];
+            zero_rows += zero[j];
+        }
+    }
+    
+    if (zero_rows > 0) {
+        fprintf(stderr, "除零错误 (%d 行)\n", zero_rows);
+    }
+    
+    for (int i = 0; i < flat_expr->count; i++) {
+        free(const_rows[i]);
+    }
+    free(const_rows);
+    free(temp_rows);
+    free(buffers);
+    free(stack);
+}
+
+#ifdef FLAT_USE_COMPUTED_GOTO
+
+/* 跳到下一条指令的处理代码，指令执行完时结束 */
+#define FLAT_DISPATCH() \
+    do { \
+        if (instr == end) goto done; \
+        FLAT_PROFILE_STEP(instr - flat_expr->instructions, 1); \
+        goto *dispatch_table[instr->op]; \
+    } while (0)
+
+/* 基于扁平数组的表达式计算 */
+double evaluate_flat(FlatExpr *flat_expr, Context *ctx) {
+    // 下标与OpCode一一对应
+    static const void *const dispatch_table[] = {
+        &&do_load_const,
+        &&do_load_var,
+        &&do_add,
+        &&do_sub,
+        &&do_mul,
+        &&do_div,
+        &&do_store_temp,
+        &&do_load_temp
+    };
+    
+    if (!flat_expr || flat_expr->count == 0) {
+        return 0.0;
+    }
+    
+    // 使用栈来存储中间结果
+    double stack[1000];
+    double *sp = stack;
+    double temps[FLAT_MAX_TEMPS];
+    const double *vars = ctx->values;
+    const Instruction *instr = flat_expr->instructions;
+    const Instruction *end = instr + flat_expr->count;
+    FLAT_PROFILE_BEGIN(flat_expr);
+    
+    FLAT_DISPATCH();
+
+do_load_const:
+    *sp++ = instr->data.value;
+    instr++;
+    FLAT_DISPATCH();
+
+do_load_var:
+    *sp++ = vars[instr->data.slot];
+    instr++;
+    FLAT_DISPATCH();
+
+do_add:
+    sp--;
+    sp[-1] = sp[-1] + sp[0];
+    instr++;
+    FLAT_DISPATCH();
+
+do_sub:
+    sp--;
+    sp[-1] = sp[-1] - sp[0];
+    instr++;
+    FLAT_DISPATCH();
+
+do_mul:
+    sp--;
+    sp[-1] = sp[-1] * sp[0];
+    instr++;
+    FLAT_DISPATCH();
+
+do_div:
+    sp--;
+    if (sp[0] == 0.0) {
+        FLAT_PROFILE_END();
+        fprintf(stderr, "除零错误\n");
+        return 0.0;
+    }
+    sp[-1] = sp[-1] / sp[0];
+    instr++;
+    FLAT_DISPATCH();
+
+do_store_temp:
+    temps[instr->data.slot] = sp[-1];
+    instr++;
+    FLAT_DISPATCH();
+
+do_load_temp:
+    *sp++ = temps[instr->data.slot];
+    instr++;
+    FLAT_DISPATCH();
+
+done:
+    FLAT_PROFILE_END();
+    
+    // 栈顶元素应该是最终结果
+    if (sp != stack + 1) {
+        fprintf(stderr, "表达式计算错误，栈不平衡\n");
+        return 0.0;
+    }
+    
+    return stack[0];
+}
+
+#else
+
+/* 基于扁平数组的表达式计算 */
+double evaluate_flat(FlatExpr *flat_expr, Context *ctx) {
+    return evaluate_flat_switch(flat_expr, ctx);
+}
+
+#endif /* FLAT_USE_COMPUTED_GOTO */
+
 /* 释放扁平化表达式 */
 void free_flat_expr(FlatExpr *flat_expr) {
     if (flat_expr) {
         if (flat_expr->instructions) {
             free(flat_expr->instructions);
         }
+#ifdef FLAT_PROFILE
+        if (flat_expr->profile) {
+            free(flat_expr->profile->counts);
+            free(flat_expr->profile->cycles);
+            free(flat_expr->profile);
+        }
+#endif
         free(flat_expr);
     }
 }
 
+/* 把一条指令格式化为文本 */
+static void format_instruction(Instruction *instr, char *text, size_t size) {
+    switch (instr->op) {
+        case OP_LOAD_CONST:
+            snprintf(text, size, "LOAD_CONST %.2f", instr->data.value);
+            break;
+            
+        case OP_LOAD_VAR:
+            snprintf(text, size, "LOAD_VAR [%d]", instr->data.slot);
+            break;
+            
+        case OP_ADD:
+            snprintf(text, size, "ADD");
+            break;
+            
+        case OP_SUB:
+            snprintf(text, size, "SUB");
+            break;
+            
+        case OP_MUL:
+            snprintf(text, size, "MUL");
+            break;
+            
+        case OP_DIV:
+            snprintf(text, size, "DIV");
+            break;
+            
+        case OP_STORE_TEMP:
+            snprintf(text, size, "STORE_TEMP t%d", instr->data.slot);
+            break;
+            
+        case OP_LOAD_TEMP:
+            snprintf(text, size, "LOAD_TEMP t%d", instr->data.slot);
+            break;
+    }
+}
+
 /* 打印扁平化表达式 */
 void print_flat_expr(FlatExpr *flat_expr) {
     if (!flat_expr) return;
     
     printf("扁平化表达式 (指令数: %d):\n", flat_expr->count);
     for (int i = 0; i < flat_expr->count; i++) {
-        Instruction *instr = &flat_expr->instructions[i];
-        printf("  %d: ", i);
-        
-        switch (instr->op) {
-            case OP_LOAD_CONST:
-                printf("LOAD_CONST %.2f", instr->data.value);
-                break;
-                
-            case OP_LOAD_VAR:
-                printf("LOAD_VAR %s", instr->data.var_name);
-                break;
-                
-            case OP_ADD:
-                printf("ADD");
-                break;
-                
-            case OP_SUB:
-                printf("SUB");
-                break;
-                
-            case OP_MUL:
-                printf("MUL");
-                break;
-                
-            case OP_DIV:
-                printf("DIV");
-                break;
+        char text[64];
+        format_instruction(&flat_expr->instructions[i], text, sizeof(text));
+        printf("  %d: %s\n", i, text);
+    }
+}
+
+#ifdef FLAT_PROFILE
+
+/* 开始统计扁平化表达式的执行情况 */
+void enable_flat_profile(FlatExpr *flat_expr) {
+    if (!flat_expr->profile) {
+        flat_expr->profile = (FlatProfile*)malloc(sizeof(FlatProfile));
+        if (!flat_expr->profile) {
+            fprintf(stderr, "内存分配失败\n");
+            exit(1);
         }
-        printf("\n");
+        flat_expr->profile->counts = NULL;
+        flat_expr->profile->cycles = NULL;
+    }
+    
+    // 指令数可能在上次开启后变化，按当前指令数重新分配
+    free(flat_expr->profile->counts);
+    free(flat_expr->profile->cycles);
+    int count = flat_expr->count > 0 ? flat_expr->count : 1;
+    flat_expr->profile->counts = (unsigned long long*)calloc(count, sizeof(unsigned long long));
+    flat_expr->profile->cycles = (unsigned long long*)calloc(count, sizeof(unsigned long long));
+    if (!flat_expr->profile->counts || !flat_expr->profile->cycles) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    
+    // 连续两次读时钟的最小间隔
+    unsigned long long overhead = ~0ULL;
+    for (int i = 0; i < 1000; i++) {
+        unsigned long long start = flat_profile_clock();
+        unsigned long long delta = flat_profile_clock() - start;
+        if (delta < overhead) {
+            overhead = delta;
+        }
+    }
+    flat_expr->profile->overhead = overhead;
+}
+
+/* 打印扁平化表达式，每条指令标注执行次数、周期数和所占比例 */
+void print_flat_profile(FlatExpr *flat_expr) {
+    if (!flat_expr) return;
+    
+    FlatProfile *profile = flat_expr->profile;
+    if (!profile) {
+        printf("扁平化表达式未开启统计\n");
+        return;
+    }
+    
+    unsigned long long total = 0;
+    for (int i = 0; i < flat_expr->count; i++) {
+        total += profile->cycles[i];
+    }
+    
+    printf("扁平化表达式执行统计 (指令数: %d, 总周期数: %llu, 每次已扣除读时钟开销 %llu):\n",
+           flat_expr->count, total, profile->overhead);
+    printf("  下标 指令                         次数           周期  周期/次    占比\n");
+    for (int i = 0; i < flat_expr->count; i++) {
+        unsigned long long count = profile->counts[i];
+        unsigned long long cycles = profile->cycles[i];
+        double share = total > 0 ? (double)cycles / total * 100.0 : 0.0;
+        
+        char text[64];
+        format_instruction(&flat_expr->instructions[i], text, sizeof(text));
+        
+        // 热度条: 每个#代表5%的周期
+        char bar[21];
+        int width = (int)(share / 5.0 + 0.5);
+        memset(bar, '#', width);
+        bar[width] = '\0';
+        
+        printf("  %-4d %-20s %12llu %14llu %8.1f %6.1f%% %s\n", i, text, count, cycles,
+               count > 0 ? (double)cycles / count : 0.0, share, bar);
     }
 }
+
+#endif /* FLAT_PROFILE */
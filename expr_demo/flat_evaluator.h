@@ -6,11 +6,13 @@
 /* 操作码 */
 typedef enum {
     OP_LOAD_CONST,    // 加载常量
-    OP_LOAD_VAR,      // 加载变量
+    OP_LOAD_VAR,      // 按槽位加载变量
     OP_ADD,           // 加法
     OP_SUB,           // 减法
     OP_MUL,           // 乘法
-    OP_DIV            // 除法
+    OP_DIV,           // 除法
+    OP_STORE_TEMP,    // 把栈顶保存到临时槽位，不出栈
+    OP_LOAD_TEMP      // 加载临时槽位
 } OpCode;
 
 /* 指令 */
@@ -18,30 +20,96 @@ typedef struct {
     OpCode op;
     union {
         double value;      // 常量值
-        char var_name[16]; // 变量名
+        int slot;          // 变量槽位或临时槽位
     } data;
 } Instruction;
 
+/*
+ * 编译时定义FLAT_PROFILE时，evaluate_flat、evaluate_flat_switch和
+ * evaluate_flat_batch可以按指令下标统计执行次数和耗费的周期数（x86上用
+ * rdtsc读时间戳计数器，其他平台用单调时钟的纳秒数）。统计对每个表达式单独
+ * 开启；不定义FLAT_PROFILE时相关代码全部编译掉，求值路径与原来完全相同。
+ */
+#ifdef FLAT_PROFILE
+typedef struct {
+    unsigned long long *counts;    // 每条指令的执行次数（批量求值按行计）
+    unsigned long long *cycles;    // 每条指令累计的周期数，已扣除读时钟的开销
+    unsigned long long overhead;   // 一次读时钟的开销
+} FlatProfile;
+#endif
+
 /* 扁平化表达式 */
 typedef struct {
     Instruction *instructions;
     int count;
     int capacity;
+    int temp_count;        // 使用的临时槽位数
+#ifdef FLAT_PROFILE
+    FlatProfile *profile;  // 为NULL时不统计
+#endif
 } FlatExpr;
 
+/* 一个表达式最多使用的临时槽位数 */
+#define FLAT_MAX_TEMPS 256
+
 /* 创建扁平化表达式 */
 FlatExpr* create_flat_expr(int initial_capacity);
 
-/* 将表达式树编译为扁平化表达式 */
-void compile_tree_to_flat(ExprNode *node, FlatExpr *flat_expr);
+/* 将表达式树编译为扁平化表达式，变量在编译时绑定到ctx中的槽位 */
+void compile_tree_to_flat(ExprNode *node, FlatExpr *flat_expr, Context *ctx);
+
+/*
+ * 消除公共子表达式后编译为扁平化表达式
+ *
+ * 先把表达式树中相同的子树合并为一个DAG（hash-consing，加法和乘法的两个
+ * 操作数不分顺序），被多处引用的运算节点只计算一次：第一次计算后用
+ * STORE_TEMP保存到临时槽位，之后的引用用LOAD_TEMP读取。
+ */
+void compile_tree_to_flat_cse(ExprNode *node, FlatExpr *flat_expr, Context *ctx);
+
+/*
+ * GCC/Clang支持标签取地址（labels as values），此时evaluate_flat用computed
+ * goto分派：每条指令处理完后直接跳到下一条指令的处理代码，每个操作码各有
+ * 一个间接跳转，分支预测器可以分别学习它们的后继。其他编译器或者定义了
+ * FLAT_NO_COMPUTED_GOTO时使用switch分派。
+ */
+#if defined(__GNUC__) && !defined(FLAT_NO_COMPUTED_GOTO)
+#define FLAT_USE_COMPUTED_GOTO
+#endif
 
 /* 基于扁平数组的表达式计算 */
 double evaluate_flat(FlatExpr *flat_expr, Context *ctx);
 
+/* 基于扁平数组的表达式计算，总是使用switch分派 */
+double evaluate_flat_switch(FlatExpr *flat_expr, Context *ctx);
+
+/* 计算指令序列需要的栈深度，栈不平衡时返回-1 */
+int flat_expr_stack_depth(FlatExpr *flat_expr);
+
+/* 批量求值时每次处理的行数 */
+#define FLAT_BATCH_SIZE 256
+
+/*
+ * 批量计算count行的表达式值
+ *
+ * columns[slot]是槽位slot对应变量的列，每列至少count个值；第i行的结果写入
+ * results[i]。每条指令一次作用于一批行，除数为零的行结果为0.0。
+ */
+void evaluate_flat_batch(FlatExpr *flat_expr, const double *const *columns,
+                         int count, double *results);
+
 /* 释放扁平化表达式 */
 void free_flat_expr(FlatExpr *flat_expr);
 
 /* 打印扁平化表达式 */
 void print_flat_expr(FlatExpr *flat_expr);
 
+#ifdef FLAT_PROFILE
+/* 开始统计扁平化表达式的执行情况，在编译完成后调用；已经开启时清零 */
+void enable_flat_profile(FlatExpr *flat_expr);
+
+/* 打印扁平化表达式，每条指令标注执行次数、周期数和所占比例 */
+void print_flat_profile(FlatExpr *flat_expr);
+#endif
+
 #endif /* FLAT_EVALUATOR_H */
@@ -0,0 +1,299 @@
+#include "jit_evaluator.h"
+
+#ifdef JIT_SUPPORTED
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * 栈式指令到x86-64机器码的翻译
+ *
+ * 扁平化表达式的值栈直接映射到xmm寄存器：深度为d的栈元素放在xmm<d>中，
+ * 因此LOAD_CONST/LOAD_VAR是一次写入xmm<d>，二元运算是一条
+ * "op xmm<d-2>, xmm<d-1>"，整个表达式不访问内存栈。xmm15保留为0.0，
+ * 供除法检查除数。临时槽位t放在[rsp - 8*(t+1)]，生成的函数不调用其他函数，
+ * 可以直接使用rsp下方128字节的red zone，不用调整栈。生成的函数签名是
+ * JitFunc：rdi指向变量数组，rsi指向结果。
+ */
+#define JIT_MAX_DEPTH 15
+#define JIT_ZERO_REG 15
+#define JIT_MAX_TEMPS 16
+
+/* 机器码缓冲区 */
+typedef struct {
+    uint8_t *code;
+    size_t length;
+    size_t *div_fixups;    // 需要回填到除零出口的rel32位置
+    int div_count;
+} JitEmitter;
+
+static void emit_byte(JitEmitter *e, uint8_t byte) {
+    e->code[e->length++] = byte;
+}
+
+static void emit_u32(JitEmitter *e, uint32_t value) {
+    memcpy(e->code + e->length, &value, sizeof(value));
+    e->length += sizeof(value);
+}
+
+static void emit_u64(JitEmitter *e, uint64_t value) {
+    memcpy(e->code + e->length, &value, sizeof(value));
+    e->length += sizeof(value);
+}
+
+/* SSE寄存器到寄存器的指令: prefix [REX] 0F opcode modrm */
+static void emit_sse_rr(JitEmitter *e, uint8_t prefix, uint8_t opcode, int dst, int src) {
+    emit_byte(e, prefix);
+    if (dst >= 8 || src >= 8) {
+        emit_byte(e, 0x40 | ((dst >> 3) << 2) | (src >> 3));
+    }
+    emit_byte(e, 0x0F);
+    emit_byte(e, opcode);
+    emit_byte(e, 0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+/* movsd xmm<dst>, [rdi + slot*8] */
+static void emit_load_var(JitEmitter *e, int dst, int slot) {
+    emit_byte(e, 0xF2);
+    if (dst >= 8) {
+        emit_byte(e, 0x44);
+    }
+    emit_byte(e, 0x0F);
+    emit_byte(e, 0x10);
+    emit_byte(e, 0x80 | ((dst & 7) << 3) | 7);
+    emit_u32(e, (uint32_t)slot * sizeof(double));
+}
+
+/* movsd xmm<reg>, [rsp - 8*(temp+1)]（opcode 0x10）或反方向的存储（opcode 0x11） */
+static void emit_temp_access(JitEmitter *e, uint8_t opcode, int reg, int temp) {
+    emit_byte(e, 0xF2);
+    if (reg >= 8) {
+        emit_byte(e, 0x44);
+    }
+    emit_byte(e, 0x0F);
+    emit_byte(e, opcode);
+    emit_byte(e, 0x40 | ((reg & 7) << 3) | 4);
+    emit_byte(e, 0x24);
+    emit_byte(e, (uint8_t)(-8 * (temp + 1)));
+}
+
+/* mov rax, imm64; movq xmm<dst>, rax */
+static void emit_load_const(JitEmitter *e, int dst, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    emit_byte(e, 0x48);
+    emit_byte(e, 0xB8);
+    emit_u64(e, bits);
+    
+    emit_byte(e, 0x66);
+    emit_byte(e, 0x48 | ((dst >> 3) << 2));
+    emit_byte(e, 0x0F);
+    emit_byte(e, 0x6E);
+    emit_byte(e, 0xC0 | ((dst & 7) << 3));
+}
+
+/* 除数为0.0时跳到除零出口；除数为NaN时比较结果无序（PF=1），照常相除 */
+static void emit_div_check(JitEmitter *e, int divisor) {
+    emit_sse_rr(e, 0x66, 0x2E, divisor, JIT_ZERO_REG);    // ucomisd xmm<divisor>, xmm15
+    emit_byte(e, 0x7A);                                  // jp +6
+    emit_byte(e, 0x06);
+    emit_byte(e, 0x0F);                                  // je rel32
+    emit_byte(e, 0x84);
+    e->div_fixups[e->div_count++] = e->length;
+    emit_u32(e, 0);
+}
+
+/* 生成整个函数，返回机器码长度 */
+static size_t jit_emit(JitEmitter *e, FlatExpr *flat_expr) {
+    int has_div = 0;
+    for (int i = 0; i < flat_expr->count; i++) {
+        if (flat_expr->instructions[i].op == OP_DIV) {
+            has_div = 1;
+        }
+    }
+    if (has_div) {
+        emit_sse_rr(e, 0x66, 0x57, JIT_ZERO_REG, JIT_ZERO_REG);   // xorpd xmm15, xmm15
+    }
+    
+    int depth = 0;
+    for (int i = 0; i < flat_expr->count; i++) {
+        Instruction *instr = &flat_expr->instructions[i];
+        
+        switch (instr->op) {
+            case OP_LOAD_CONST:
+                emit_load_const(e, depth++, instr->data.value);
+                break;
+                
+            case OP_LOAD_VAR:
+                emit_load_var(e, depth++, instr->data.slot);
+                break;
+                
+            case OP_ADD:
+                depth--;
+                emit_sse_rr(e, 0xF2, 0x58, depth - 1, depth);       // addsd
+                break;
+                
+            case OP_SUB:
+                depth--;
+                emit_sse_rr(e, 0xF2, 0x5C, depth - 1, depth);       // subsd
+                break;
+                
+            case OP_MUL:
+                depth--;
+                emit_sse_rr(e, 0xF2, 0x59, depth - 1, depth);       // mulsd
+                break;
+                
+            case OP_DIV:
+                depth--;
+                emit_div_check(e, depth);
+                emit_sse_rr(e, 0xF2, 0x5E, depth - 1, depth);       // divsd
+                break;
+                
+            case OP_STORE_TEMP:
+                emit_temp_access(e, 0x11, depth - 1, instr->data.slot);
+                break;
+                
+            case OP_LOAD_TEMP:
+                emit_temp_access(e, 0x10, depth++, instr->data.slot);
+                break;
+        }
+    }
+    
+    // movsd [rsi], xmm0; xor eax, eax; ret
+    emit_byte(e, 0xF2);
+    emit_byte(e, 0x0F);
+    emit_byte(e, 0x11);
+    emit_byte(e, 0x06);
+    emit_byte(e, 0x31);
+    emit_byte(e, 0xC0);
+    emit_byte(e, 0xC3);
+    
+    // 除零出口: mov eax, 1; ret
+    if (e->div_count > 0) {
+        size_t exit_pos = e->length;
+        emit_byte(e, 0xB8);
+        emit_u32(e, 1);
+        emit_byte(e, 0xC3);
+        for (int i = 0; i < e->div_count; i++) {
+            uint32_t rel = (uint32_t)(exit_pos - (e->div_fixups[i] + 4));
+            memcpy(e->code + e->div_fixups[i], &rel, sizeof(rel));
+        }
+    }
+    
+    return e->length;
+}
+
+/* 把扁平化表达式编译为机器码，失败时保持未编译状态 */
+static void jit_compile(JitExpr *jit_expr) {
+    FlatExpr *flat_expr = jit_expr->flat_expr;
+    int depth = flat_expr_stack_depth(flat_expr);
+    if (depth < 0 || depth > JIT_MAX_DEPTH || flat_expr->temp_count > JIT_MAX_TEMPS) {
+        return;
+    }
+    
+    // 每条指令最多18字节（LOAD_CONST 15字节，DIV 18字节），另加序言和出口
+    size_t max_length = (size_t)flat_expr->count * 18 + 32;
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t size = (max_length + page_size - 1) / page_size * page_size;
+    
+    void *code = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return;
+    }
+    
+    JitEmitter emitter;
+    emitter.code = (uint8_t*)code;
+    emitter.length = 0;
+    emitter.div_count = 0;
+    emitter.div_fixups = (size_t*)malloc(sizeof(size_t) * (flat_expr->count + 1));
+    if (!emitter.div_fixups) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    
+    size_t length = jit_emit(&emitter, flat_expr);
+    free(emitter.div_fixups);
+    
+    // 写完后改为只读可执行，缓冲区不会同时可写可执行
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, size);
+        return;
+    }
+    
+    jit_expr->code = code;
+    jit_expr->code_size = size;
+    jit_expr->code_length = length;
+    jit_expr->func = (JitFunc)code;
+}
+
+#endif /* JIT_SUPPORTED */
+
+/* 为扁平化表达式创建JIT表达式 */
+JitExpr* create_jit_expr(FlatExpr *flat_expr, long expected_evals) {
+    JitExpr *jit_expr = (JitExpr*)malloc(sizeof(JitExpr));
+    if (!jit_expr) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    
+    jit_expr->flat_expr = flat_expr;
+    jit_expr->code = NULL;
+    jit_expr->code_size = 0;
+    jit_expr->code_length = 0;
+    jit_expr->func = NULL;
+
+#ifdef JIT_SUPPORTED
+    if (flat_expr && flat_expr->count > 0 &&
+        expected_evals * flat_expr->count >= JIT_ABOVE_COST) {
+        jit_compile(jit_expr);
+    }
+#else
+    (void)expected_evals;
+#endif
+    
+    return jit_expr;
+}
+
+/* 计算JIT表达式 */
+double evaluate_jit(JitExpr *jit_expr, Context *ctx) {
+    if (!jit_expr->func) {
+        return evaluate_flat(jit_expr->flat_expr, ctx);
+    }
+    
+#ifdef FLAT_PROFILE
+    // 机器码没有指令边界，统计时解释执行
+    if (jit_expr->flat_expr->profile) {
+        return evaluate_flat(jit_expr->flat_expr, ctx);
+    }
+#endif
+    
+    double result;
+    if (jit_expr->func(ctx->values, &result) != 0) {
+        fprintf(stderr, "除零错误\n");
+        return 0.0;
+    }
+    return result;
+}
+
+/* 释放JIT表达式 */
+void free_jit_expr(JitExpr *jit_expr) {
+    if (jit_expr) {
+#ifdef JIT_SUPPORTED
+        if (jit_expr->code) {
+            munmap(jit_expr->code, jit_expr->code_size);
+        }
+#endif
+        free(jit_expr);
+    }
+}
+
+/* 打印JIT表达式的编译状态 */
+void print_jit_expr(JitExpr *jit_expr) {
+    if (!jit_expr) return;
+    
+    if (jit_expr->func) {
+        printf("JIT: 已编译为 %zu 字节机器码\n", jit_expr->code_length);
+    } else {
+        printf("JIT: 未编译，使用解释执行\n");
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef JIT_EVALUATOR_H
+#define JIT_EVALUATOR_H
+
+#include "flat_evaluator.h"
+
+/*
+ * 只在x86-64 Linux上生成机器码（System V调用约定，所有xmm寄存器都由调用者
+ * 保存）；其他平台总是回退到evaluate_flat。
+ */
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED
+#endif
+
+/*
+ * 编译阈值：预计执行的指令总数（求值次数 * 指令数）达到这个值时才编译，
+ * 执行次数少时生成机器码的开销收不回来
+ */
+#define JIT_ABOVE_COST 100000L
+
+/* 生成的函数: 变量值按槽位存放在vars中，结果写入*result；除零时返回1 */
+typedef int (*JitFunc)(const double *vars, double *result);
+
+/* JIT表达式 */
+typedef struct {
+    FlatExpr *flat_expr;   // 源指令序列，未编译时用它解释执行（不归JitExpr所有）
+    void *code;            // 可执行的机器码缓冲区，未编译时为NULL
+    size_t code_size;      // 缓冲区大小
+    size_t code_length;    // 生成的机器码字节数
+    JitFunc func;
+} JitExpr;
+
+/*
+ * 为扁平化表达式创建JIT表达式
+ *
+ * expected_evals是预计的求值次数。不满足阈值、平台不支持、表达式需要的
+ * 栈深度超过可用的xmm寄存器、临时槽位超过16个或者分配可执行内存失败时
+ * 不编译，求值时回退到evaluate_flat。
+ */
+JitExpr* create_jit_expr(FlatExpr *flat_expr, long expected_evals);
+
+/* 计算JIT表达式，扁平化表达式开启了指令级统计（FLAT_PROFILE）时解释执行 */
+double evaluate_jit(JitExpr *jit_expr, Context *ctx);
+
+/* 释放JIT表达式 */
+void free_jit_expr(JitExpr *jit_expr);
+
+/* 打印JIT表达式的编译状态 */
+void print_jit_expr(JitExpr *jit_expr);
+
+#endif /* JIT_EVALUATOR_H */
@@ -2,8 +2,19 @@
 #include <stdlib.h>
 #include <time.h>
 #include "expr_tree.h"
+#include "expr_optimizer.h"
 #include "tree_evaluator.h"
 #include "flat_evaluator.h"
+#include "reg_evaluator.h"
+#include "jit_evaluator.h"
+#include "typed_evaluator.h"
+
+// evaluate_flat使用的分派方式
+#ifdef FLAT_USE_COMPUTED_GOTO
+#define FLAT_DISPATCH_NAME "computed goto"
+#else
+#define FLAT_DISPATCH_NAME "switch"
+#endif
 
 // 生成随机表达式树
 ExprNode* generate_random_expr(int depth, int max_depth, Context *ctx) {
@@ -27,6 +38,51 @@ ExprNode* generate_random_expr(int depth, int max_depth, Context *ctx) {
     }
 }
 
+// 按上下文中的变量值计算表达式，遇到除数为0时置*div_zero，不打印除零错误
+static double eval_checking_div_zero(ExprNode *node, Context *ctx, int *div_zero) {
+    switch (node->type) {
+        case NODE_CONST:
+            return node->data.value;
+        case NODE_VAR:
+            return get_variable(ctx, node->data.var_name);
+        default: {
+            double left = eval_checking_div_zero(node->data.op.left, ctx, div_zero);
+            double right = eval_checking_div_zero(node->data.op.right, ctx, div_zero);
+            switch (node->type) {
+                case NODE_ADD: return left + right;
+                case NODE_SUB: return left - right;
+                case NODE_MUL: return left * right;
+                case NODE_DIV:
+                    if (right == 0.0) {
+                        *div_zero = 1;
+                        return 0.0;
+                    }
+                    return left / right;
+                default: return 0.0;
+            }
+        }
+    }
+}
+
+// 生成在所有行上都不会除零的随机表达式，避免除零错误的输出计入计时
+ExprNode* generate_row_safe_expr(int max_depth, Context *ctx, double **columns,
+                                 const int *slots, int num_rows) {
+    for (;;) {
+        ExprNode *expr = generate_random_expr(0, max_depth, ctx);
+        int div_zero = 0;
+        for (int r = 0; r < num_rows && !div_zero; r++) {
+            for (int v = 0; v < 5; v++) {
+                ctx->values[slots[v]] = columns[v][r];
+            }
+            eval_checking_div_zero(expr, ctx, &div_zero);
+        }
+        if (!div_zero) {
+            return expr;
+        }
+        free_expr_tree(expr);
+    }
+}
+
 // 性能测试
 void performance_test(int num_tests, int max_depth) {
     printf("开始性能测试 (测试次数: %d, 最大深度: %d)\n", num_tests, max_depth);
@@ -41,7 +97,12 @@ void performance_test(int num_tests, int max_depth) {
     
     // 总时间统计
     double total_tree_time = 0.0;
+    double total_switch_time = 0.0;
     double total_flat_time = 0.0;
+    double total_reg_time = 0.0;
+    double total_jit_time = 0.0;
+    double total_optimized_time = 0.0;
+    double total_cse_time = 0.0;
     
     for (int test = 0; test < num_tests; test++) {
         // 生成随机表达式
@@ -49,11 +110,21 @@ void performance_test(int num_tests, int max_depth) {
         
         // 编译为扁平表达式
         FlatExpr *flat_expr = create_flat_expr(100);
-        compile_tree_to_flat(expr, flat_expr);
+        compile_tree_to_flat(expr, flat_expr, ctx);
+        
+        // 编译为寄存器表达式
+        RegExpr *reg_expr = create_reg_expr(100);
+        compile_tree_to_reg(expr, reg_expr, ctx);
+        
+        // 编译为机器码，下面要执行100万次，超过JIT阈值
+        JitExpr *jit_expr = create_jit_expr(flat_expr, 1000000);
         
         // 预热
         evaluate_tree(expr, ctx);
+        evaluate_flat_switch(flat_expr, ctx);
         evaluate_flat(flat_expr, ctx);
+        evaluate_reg(reg_expr, ctx);
+        evaluate_jit(jit_expr, ctx);
         
         // 测试树遍历方法
         clock_t start = clock();
@@ -64,7 +135,16 @@ void performance_test(int num_tests, int max_depth) {
         double tree_time = (double)(end - start) / CLOCKS_PER_SEC;
         total_tree_time += tree_time;
         
-        // 测试扁平数组方法
+        // 测试扁平数组方法，switch分派
+        start = clock();
+        for (int i = 0; i < 1000000; i++) {
+            evaluate_flat_switch(flat_expr, ctx);
+        }
+        end = clock();
+        double switch_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_switch_time += switch_time;
+        
+        // 测试扁平数组方法，evaluate_flat使用的分派方式
         start = clock();
         for (int i = 0; i < 1000000; i++) {
             evaluate_flat(flat_expr, ctx);
@@ -73,30 +153,291 @@ void performance_test(int num_tests, int max_depth) {
         double flat_time = (double)(end - start) / CLOCKS_PER_SEC;
         total_flat_time += flat_time;
         
+        // 测试寄存器方法
+        start = clock();
+        for (int i = 0; i < 1000000; i++) {
+            evaluate_reg(reg_expr, ctx);
+        }
+        end = clock();
+        double reg_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_reg_time += reg_time;
+        
+        // 测试JIT方法
+        start = clock();
+        for (int i = 0; i < 1000000; i++) {
+            evaluate_jit(jit_expr, ctx);
+        }
+        end = clock();
+        double jit_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_jit_time += jit_time;
+        
         // 打印当前测试结果
         printf("测试 #%d:\n", test + 1);
         printf("  表达式: ");
         print_expr_tree(expr);
         printf("\n");
         printf("  树遍历时间: %.6f 秒\n", tree_time);
-        printf("  扁平数组时间: %.6f 秒\n", flat_time);
-        printf("  性能提升: %.2f%%\n", (tree_time - flat_time) / tree_time * 100.0);
+        printf("  扁平数组时间 (switch): %.6f 秒 (指令数: %d)\n", switch_time, flat_expr->count);
+        printf("  扁平数组时间 (%s): %.6f 秒\n", FLAT_DISPATCH_NAME, flat_time);
+        printf("  寄存器时间: %.6f 秒 (指令数: %d)\n", reg_time, reg_expr->count);
+        printf("  JIT时间: %.6f 秒 (%s)\n", jit_time,
+               jit_expr->func ? "机器码" : "解释执行");
+        printf("  性能提升: 扁平数组 %.2f%%, 寄存器 %.2f%%, JIT %.2f%%\n",
+               (tree_time - flat_time) / tree_time * 100.0,
+               (tree_time - reg_time) / tree_time * 100.0,
+               (tree_time - jit_time) / tree_time * 100.0);
+        printf("  %s相对switch: %.2f%%\n", FLAT_DISPATCH_NAME,
+               (switch_time - flat_time) / switch_time * 100.0);
+        
+        // 优化表达式树后重新编译，与优化前的扁平数组方法对比
+        expr = optimize_expr_tree(expr);
+        FlatExpr *optimized_flat = create_flat_expr(100);
+        compile_tree_to_flat(expr, optimized_flat, ctx);
+        evaluate_flat(optimized_flat, ctx);
+        start = clock();
+        for (int i = 0; i < 1000000; i++) {
+            evaluate_flat(optimized_flat, ctx);
+        }
+        end = clock();
+        double optimized_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_optimized_time += optimized_time;
+        
+        printf("  优化后表达式: ");
+        print_expr_tree(expr);
+        printf("\n");
+        printf("  优化后扁平数组时间: %.6f 秒 (指令数: %d -> %d), 提升 %.2f%%\n",
+               optimized_time, flat_expr->count, optimized_flat->count,
+               (flat_time - optimized_time) / flat_time * 100.0);
+        
+        // 优化后的树再消除公共子表达式
+        FlatExpr *cse_flat = create_flat_expr(100);
+        compile_tree_to_flat_cse(expr, cse_flat, ctx);
+        evaluate_flat(cse_flat, ctx);
+        start = clock();
+        for (int i = 0; i < 1000000; i++) {
+            evaluate_flat(cse_flat, ctx);
+        }
+        end = clock();
+        double cse_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_cse_time += cse_time;
+        printf("  CSE后扁平数组时间: %.6f 秒 (指令数: %d, 临时槽位: %d)\n",
+               cse_time, cse_flat->count, cse_flat->temp_count);
         
         // 释放资源
         free_expr_tree(expr);
         free_flat_expr(flat_expr);
+        free_flat_expr(optimized_flat);
+        free_flat_expr(cse_flat);
+        free_reg_expr(reg_expr);
+        free_jit_expr(jit_expr);
     }
     
     // 打印总结
     printf("\n总结:\n");
     printf("  平均树遍历时间: %.6f 秒\n", total_tree_time / num_tests);
-    printf("  平均扁平数组时间: %.6f 秒\n", total_flat_time / num_tests);
-    printf("  平均性能提升: %.2f%%\n", 
-           (total_tree_time - total_flat_time) / total_tree_time * 100.0);
+    printf("  平均扁平数组时间 (switch): %.6f 秒\n", total_switch_time / num_tests);
+    printf("  平均扁平数组时间 (%s): %.6f 秒\n", FLAT_DISPATCH_NAME, total_flat_time / num_tests);
+    printf("  平均寄存器时间: %.6f 秒\n", total_reg_time / num_tests);
+    printf("  平均JIT时间: %.6f 秒\n", total_jit_time / num_tests);
+    printf("  平均性能提升: 扁平数组 %.2f%%, 寄存器 %.2f%%, JIT %.2f%%\n",
+           (total_tree_time - total_flat_time) / total_tree_time * 100.0,
+           (total_tree_time - total_reg_time) / total_tree_time * 100.0,
+           (total_tree_time - total_jit_time) / total_tree_time * 100.0);
+    printf("  平均%s相对switch: %.2f%%\n", FLAT_DISPATCH_NAME,
+           (total_switch_time - total_flat_time) / total_switch_time * 100.0);
+    printf("  平均优化后扁平数组时间: %.6f 秒, 提升 %.2f%%\n",
+           total_optimized_time / num_tests,
+           (total_flat_time - total_optimized_time) / total_flat_time * 100.0);
+    printf("  平均CSE后扁平数组时间: %.6f 秒\n", total_cse_time / num_tests);
     
     free_context(ctx);
 }
 
+// 批量求值性能测试: 逐行调用evaluate_flat与evaluate_flat_batch对比
+void batch_performance_test(int num_tests, int max_depth, int num_rows) {
+    printf("\n开始批量求值测试 (测试次数: %d, 最大深度: %d, 行数: %d)\n",
+           num_tests, max_depth, num_rows);
+    
+    // 每个变量一列，列按变量的槽位排列
+    Context *ctx = create_context(10);
+    double *columns[5];
+    const double *slot_columns[10];
+    int slots[5];
+    for (int v = 0; v < 5; v++) {
+        char var_name[16];
+        sprintf(var_name, "x%d", v);
+        slots[v] = bind_variable_slot(ctx, var_name);
+        columns[v] = (double*)malloc(sizeof(double) * num_rows);
+        if (!columns[v]) {
+            fprintf(stderr, "内存分配失败\n");
+            exit(1);
+        }
+        for (int r = 0; r < num_rows; r++) {
+            columns[v][r] = (double)(rand() % 1000) / 10.0;
+        }
+        slot_columns[slots[v]] = columns[v];
+    }
+    
+    double *row_results = (double*)malloc(sizeof(double) * num_rows);
+    double *batch_results = (double*)malloc(sizeof(double) * num_rows);
+    if (!row_results || !batch_results) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    
+    double total_row_time = 0.0;
+    double total_batch_time = 0.0;
+    
+    for (int test = 0; test < num_tests; test++) {
+        ExprNode *expr = generate_row_safe_expr(max_depth, ctx, columns, slots, num_rows);
+        FlatExpr *flat_expr = create_flat_expr(100);
+        compile_tree_to_flat(expr, flat_expr, ctx);
+        
+        // 逐行求值，每行先把变量值写入上下文
+        clock_t start = clock();
+        for (int r = 0; r < num_rows; r++) {
+            for (int v = 0; v < 5; v++) {
+                ctx->values[slots[v]] = columns[v][r];
+            }
+            row_results[r] = evaluate_flat(flat_expr, ctx);
+        }
+        clock_t end = clock();
+        double row_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_row_time += row_time;
+        
+        // 批量求值
+        start = clock();
+        evaluate_flat_batch(flat_expr, slot_columns, num_rows, batch_results);
+        end = clock();
+        double batch_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_batch_time += batch_time;
+        
+        // 两种方法的结果应该完全一致
+        int mismatches = 0;
+        for (int r = 0; r < num_rows; r++) {
+            if (row_results[r] != batch_results[r] &&
+                !(row_results[r] != row_results[r] && batch_results[r] != batch_results[r])) {
+                mismatches++;
+            }
+        }
+        
+        printf("测试 #%d:\n", test + 1);
+        printf("  表达式: ");
+        print_expr_tree(expr);
+        printf("\n");
+        printf("  逐行时间: %.6f 秒\n", row_time);
+        printf("  批量时间: %.6f 秒\n", batch_time);
+        printf("  加速比: %.1fx, 结果不一致的行数: %d\n",
+               batch_time > 0.0 ? row_time / batch_time : 0.0, mismatches);
+        
+        free_expr_tree(expr);
+        free_flat_expr(flat_expr);
+    }
+    
+    printf("\n总结:\n");
+    printf("  平均逐行时间: %.6f 秒\n", total_row_time / num_tests);
+    printf("  平均批量时间: %.6f 秒\n", total_batch_time / num_tests);
+    printf("  平均加速比: %.1fx\n",
+           total_batch_time > 0.0 ? total_row_time / total_batch_time : 0.0);
+    
+    for (int v = 0; v < 5; v++) {
+        free(columns[v]);
+    }
+    free(row_results);
+    free(batch_results);
+    free_context(ctx);
+}
+
+// 短路求值性能测试: 选择性高的条件放在AND的前面和后面对比
+void filter_performance_test(int num_tests, int max_depth, int num_rows) {
+    printf("\n开始过滤条件测试 (测试次数: %d, 最大深度: %d, 行数: %d)\n",
+           num_tests, max_depth, num_rows);
+    
+    Context *ctx = create_context(10);
+    double *columns[5];
+    int slots[5];
+    for (int v = 0; v < 5; v++) {
+        char var_name[16];
+        sprintf(var_name, "x%d", v);
+        set_variable(ctx, var_name, 0.0);
+        slots[v] = bind_variable_slot(ctx, var_name);
+        columns[v] = (double*)malloc(sizeof(double) * num_rows);
+        if (!columns[v]) {
+            fprintf(stderr, "内存分配失败\n");
+            exit(1);
+        }
+        for (int r = 0; r < num_rows; r++) {
+            columns[v][r] = (double)(rand() % 1000) / 10.0;
+        }
+    }
+    
+    double total_first_time = 0.0;
+    double total_last_time = 0.0;
+    
+    for (int test = 0; test < num_tests; test++) {
+        // x0 < 5.0 只有约5%的行满足
+        ExprNode *expr = generate_row_safe_expr(max_depth, ctx, columns, slots, num_rows);
+        ExprNode *first = create_op_node(NODE_AND,
+            create_op_node(NODE_LT, create_var_node("x0"), create_const_node(5.0)),
+            create_op_node(NODE_GT, expr, create_const_node(0.0)));
+        ExprNode *last = create_op_node(NODE_AND,
+            create_op_node(NODE_GT, copy_expr_tree(expr), create_const_node(0.0)),
+            create_op_node(NODE_LT, create_var_node("x0"), create_const_node(5.0)));
+        
+        TypedExpr *first_expr = create_typed_expr(100);
+        TypedExpr *last_expr = create_typed_expr(100);
+        compile_tree_to_typed(first, first_expr, ctx);
+        compile_tree_to_typed(last, last_expr, ctx);
+        
+        int first_matches = 0;
+        clock_t start = clock();
+        for (int r = 0; r < num_rows; r++) {
+            for (int v = 0; v < 5; v++) {
+                ctx->values[slots[v]] = columns[v][r];
+            }
+            Value value = evaluate_typed(first_expr, ctx);
+            first_matches += !value.is_null && value.data.b;
+        }
+        clock_t end = clock();
+        double first_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_first_time += first_time;
+        
+        int last_matches = 0;
+        start = clock();
+        for (int r = 0; r < num_rows; r++) {
+            for (int v = 0; v < 5; v++) {
+                ctx->values[slots[v]] = columns[v][r];
+            }
+            Value value = evaluate_typed(last_expr, ctx);
+            last_matches += !value.is_null && value.data.b;
+        }
+        end = clock();
+        double last_time = (double)(end - start) / CLOCKS_PER_SEC;
+        total_last_time += last_time;
+        
+        printf("测试 #%d:\n", test + 1);
+        printf("  条件: ");
+        print_expr_tree(first);
+        printf("\n");
+        printf("  选择性条件在前: %.6f 秒, 满足的行数: %d\n", first_time, first_matches);
+        printf("  选择性条件在后: %.6f 秒, 满足的行数: %d\n", last_time, last_matches);
+        
+        free_expr_tree(first);
+        free_expr_tree(last);
+        free_typed_expr(first_expr);
+        free_typed_expr(last_expr);
+    }
+    
+    printf("\n总结:\n");
+    printf("  平均选择性条件在前时间: %.6f 秒\n", total_first_time / num_tests);
+    printf("  平均选择性条件在后时间: %.6f 秒\n", total_last_time / num_tests);
+    
+    for (int v = 0; v < 5; v++) {
+        free(columns[v]);
+    }
+    free_context(ctx);
+}
+
 // 示例表达式: (x0 + 2.5) * (x1 - 1.0) / (x2 + x3)
 ExprNode* create_example_expr() {
     ExprNode *x0 = create_var_node("x0");
@@ -116,6 +457,102 @@ ExprNode* create_example_expr() {
     return create_op_node(NODE_DIV, mul1, add2);
 }
 
+// 公共子表达式示例: (x0 + x1) * (x0 + x1) - (x1 + x0) / x2
+ExprNode* create_cse_example_expr() {
+    ExprNode *sum1 = create_op_node(NODE_ADD, create_var_node("x0"), create_var_node("x1"));
+    ExprNode *sum2 = create_op_node(NODE_ADD, create_var_node("x0"), create_var_node("x1"));
+    ExprNode *square = create_op_node(NODE_MUL, sum1, sum2);
+    
+    ExprNode *sum3 = create_op_node(NODE_ADD, create_var_node("x1"), create_var_node("x0"));
+    ExprNode *quotient = create_op_node(NODE_DIV, sum3, create_var_node("x2"));
+    
+    return create_op_node(NODE_SUB, square, quotient);
+}
+
+// 带类型的求值示例: 整数、double、布尔与NULL
+void typed_demo() {
+    Context *ctx = create_context(10);
+    set_int_variable(ctx, "qty", 7);
+    set_variable(ctx, "price", 2.5);
+    set_null_variable(ctx, "discount");
+    
+    ExprNode *exprs[8];
+    // qty * 3 + 1
+    exprs[0] = create_op_node(NODE_ADD,
+        create_op_node(NODE_MUL, create_var_node("qty"), create_int_const_node(3)),
+        create_int_const_node(1));
+    // qty * price > 10
+    exprs[1] = create_op_node(NODE_GT,
+        create_op_node(NODE_MUL, create_var_node("qty"), create_var_node("price")),
+        create_int_const_node(10));
+    // price - discount
+    exprs[2] = create_op_node(NODE_SUB, create_var_node("price"), create_var_node("discount"));
+    // qty / 2
+    exprs[3] = create_op_node(NODE_DIV, create_var_node("qty"), create_int_const_node(2));
+    // qty + true，类型错误
+    exprs[4] = create_op_node(NODE_ADD, create_var_node("qty"), create_bool_const_node(1));
+    // qty > 5 AND price < 2.0 AND discount > 0，第二项为false，跳过第三项
+    exprs[5] = create_op_node(NODE_AND,
+        create_op_node(NODE_AND,
+            create_op_node(NODE_GT, create_var_node("qty"), create_int_const_node(5)),
+            create_op_node(NODE_LT, create_var_node("price"), create_const_node(2.0))),
+        create_op_node(NODE_GT, create_var_node("discount"), create_int_const_node(0)));
+    // discount > 0 AND qty > 5，NULL AND true 为NULL
+    exprs[6] = create_op_node(NODE_AND,
+        create_op_node(NODE_GT, create_var_node("discount"), create_int_const_node(0)),
+        create_op_node(NODE_GT, create_var_node("qty"), create_int_const_node(5)));
+    // discount > 0 OR qty > 5，NULL OR true 为true
+    exprs[7] = create_op_node(NODE_OR,
+        create_op_node(NODE_GT, create_var_node("discount"), create_int_const_node(0)),
+        create_op_node(NODE_GT, create_var_node("qty"), create_int_const_node(5)));
+    
+    printf("带类型的求值 (qty = 7, price = 2.5, discount = NULL)\n");
+    for (int i = 0; i < 8; i++) {
+        printf("表达式: ");
+        print_expr_tree(exprs[i]);
+        printf("\n");
+        
+        TypedExpr *typed_expr = create_typed_expr(20);
+        if (compile_tree_to_typed(exprs[i], typed_expr, ctx) == 0) {
+            print_typed_expr(typed_expr);
+            printf("结果: ");
+            print_value(evaluate_typed(typed_expr, ctx), typed_expr->result_type);
+            printf("\n");
+        } else {
+            printf("编译失败\n");
+        }
+        printf("\n");
+        
+        free_typed_expr(typed_expr);
+        free_expr_tree(exprs[i]);
+    }
+    
+    free_context(ctx);
+}
+
+#ifdef FLAT_PROFILE
+// 指令级统计: 示例表达式求值100万次后，标注每条指令的执行次数和周期数
+void profile_demo(Context *ctx) {
+    ExprNode *expr = create_example_expr();
+    FlatExpr *flat_expr = create_flat_expr(20);
+    compile_tree_to_flat(expr, flat_expr, ctx);
+    
+    printf("\n指令级统计 (%s, 求值100万次)\n", FLAT_DISPATCH_NAME);
+    printf("表达式: ");
+    print_expr_tree(expr);
+    printf("\n");
+    
+    enable_flat_profile(flat_expr);
+    for (int i = 0; i < 1000000; i++) {
+        evaluate_flat(flat_expr, ctx);
+    }
+    print_flat_profile(flat_expr);
+    
+    free_expr_tree(expr);
+    free_flat_expr(flat_expr);
+}
+#endif
+
 int main() {
     // 设置随机数种子
     srand(time(NULL));
@@ -144,7 +581,7 @@ int main() {
     
     // 编译为扁平表达式
     FlatExpr *flat_expr = create_flat_expr(20);
-    compile_tree_to_flat(expr, flat_expr);
+    compile_tree_to_flat(expr, flat_expr, ctx);
     
     // 打印扁平表达式
     print_flat_expr(flat_expr);
@@ -154,12 +591,55 @@ int main() {
     double flat_result = evaluate_flat(flat_expr, ctx);
     printf("扁平数组结果: %.6f\n\n", flat_result);
     
+    // 编译为寄存器表达式并计算
+    RegExpr *reg_expr = create_reg_expr(20);
+    compile_tree_to_reg(expr, reg_expr, ctx);
+    print_reg_expr(reg_expr);
+    printf("\n");
+    double reg_result = evaluate_reg(reg_expr, ctx);
+    printf("寄存器结果: %.6f\n\n", reg_result);
+    
+    // 只求值一次时低于JIT阈值，回退到解释执行；预计求值100万次时编译为机器码
+    JitExpr *jit_once = create_jit_expr(flat_expr, 1);
+    print_jit_expr(jit_once);
+    printf("JIT结果 (求值1次): %.6f\n", evaluate_jit(jit_once, ctx));
+    JitExpr *jit_expr = create_jit_expr(flat_expr, 1000000);
+    print_jit_expr(jit_expr);
+    printf("JIT结果 (求值100万次): %.6f\n\n", evaluate_jit(jit_expr, ctx));
+    
+    // 公共子表达式消除
+    ExprNode *cse_expr = create_cse_example_expr();
+    printf("公共子表达式示例: ");
+    print_expr_tree(cse_expr);
+    printf("\n");
+    FlatExpr *plain_flat = create_flat_expr(20);
+    compile_tree_to_flat(cse_expr, plain_flat, ctx);
+    FlatExpr *cse_flat = create_flat_expr(20);
+    compile_tree_to_flat_cse(cse_expr, cse_flat, ctx);
+    print_flat_expr(cse_flat);
+    printf("CSE前指令数: %d, CSE后指令数: %d\n", plain_flat->count, cse_flat->count);
+    printf("CSE前结果: %.6f, CSE后结果: %.6f\n\n",
+           evaluate_flat(plain_flat, ctx), evaluate_flat(cse_flat, ctx));
+    
+    typed_demo();
+    
     // 进行性能测试
     performance_test(5, 5);
+    batch_performance_test(5, 5, 1000000);
+    filter_performance_test(5, 5, 1000000);
+#ifdef FLAT_PROFILE
+    profile_demo(ctx);
+#endif
     
     // 释放资源
     free_expr_tree(expr);
     free_flat_expr(flat_expr);
+    free_reg_expr(reg_expr);
+    free_jit_expr(jit_once);
+    free_jit_expr(jit_expr);
+    free_expr_tree(cse_expr);
+    free_flat_expr(plain_flat);
+    free_flat_expr(cse_flat);
     free_context(ctx);
     
     return 0;
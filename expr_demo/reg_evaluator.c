@@ -0,0 +1,324 @@
+#include "reg_evaluator.h"
+
+/*
+ * 编译时的寄存器分配状态
+ *
+ * 编译过程中常量使用负编号 -(k+1)，其余寄存器从0开始编号；编译结束后
+ * 常量放到寄存器0..const_count-1，其余寄存器整体后移，这样求值时只需把
+ * 常量表复制到寄存器文件开头。同一个变量只加载一次，临时寄存器在
+ * 被使用后立即放回空闲列表供后续节点重用。
+ */
+typedef struct {
+    RegExpr *reg_expr;
+    Context *ctx;
+    int next_reg;                              // 下一个新寄存器的编号
+    int free_regs[REG_MAX_REGISTERS];          // 空闲的临时寄存器
+    int free_count;
+    int var_slots[REG_MAX_REGISTERS];          // 已加载的变量槽位
+    int var_regs[REG_MAX_REGISTERS];           // 变量所在的寄存器
+    int var_count;
+} RegCompiler;
+
+/* 创建寄存器表达式 */
+RegExpr* create_reg_expr(int initial_capacity) {
+    RegExpr *reg_expr = (RegExpr*)malloc(sizeof(RegExpr));
+    if (!reg_expr) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    
+    reg_expr->instructions = (RegInstruction*)malloc(sizeof(RegInstruction) * initial_capacity);
+    reg_expr->constants = (double*)malloc(sizeof(double) * initial_capacity);
+    if (!reg_expr->instructions || !reg_expr->constants) {
+        fprintf(stderr, "内存分配失败\n");
+        free(reg_expr->instructions);
+        free(reg_expr->constants);
+        free(reg_expr);
+        exit(1);
+    }
+    
+    reg_expr->count = 0;
+    reg_expr->capacity = initial_capacity;
+    reg_expr->const_count = 0;
+    reg_expr->const_capacity = initial_capacity;
+    reg_expr->reg_count = 0;
+    reg_expr->result_reg = 0;
+    
+    return reg_expr;
+}
+
+/* 添加指令 */
+static void add_reg_instruction(RegExpr *reg_expr, RegInstruction instr) {
+    if (reg_expr->count >= reg_expr->capacity) {
+        int new_capacity = reg_expr->capacity * 2;
+        reg_expr->instructions = (RegInstruction*)realloc(
+            reg_expr->instructions, sizeof(RegInstruction) * new_capacity);
+        if (!reg_expr->instructions) {
+            fprintf(stderr, "内存重分配失败\n");
+            exit(1);
+        }
+        reg_expr->capacity = new_capacity;
+    }
+    
+    reg_expr->instructions[reg_expr->count++] = instr;
+}
+
+/* 为常量分配寄存器，相同的常量共用一个寄存器；返回编译期的负编号 */
+static int alloc_const_reg(RegExpr *reg_expr, double value) {
+    for (int i = 0; i < reg_expr->const_count; i++) {
+        if (memcmp(&reg_expr->constants[i], &value, sizeof(double)) == 0) {
+            return -(i + 1);
+        }
+    }
+    
+    if (reg_expr->const_count >= REG_MAX_REGISTERS) {
+        fprintf(stderr, "表达式需要的寄存器过多\n");
+        exit(1);
+    }
+    
+    if (reg_expr->const_count >= reg_expr->const_capacity) {
+        int new_capacity = reg_expr->const_capacity * 2;
+        reg_expr->constants = (double*)realloc(
+            reg_expr->constants, sizeof(double) * new_capacity);
+        if (!reg_expr->constants) {
+            fprintf(stderr, "内存重分配失败\n");
+            exit(1);
+        }
+        reg_expr->const_capacity = new_capacity;
+    }
+    
+    reg_expr->constants[reg_expr->const_count++] = value;
+    return -reg_expr->const_count;
+}
+
+/* 分配一个寄存器，优先重用空闲的临时寄存器 */
+static int alloc_reg(RegCompiler *compiler) {
+    if (compiler->free_count > 0) {
+        return compiler->free_regs[--compiler->free_count];
+    }
+    if (compiler->next_reg + compiler->reg_expr->const_count >= REG_MAX_REGISTERS) {
+        fprintf(stderr, "表达式需要的寄存器过多\n");
+        exit(1);
+    }
+    return compiler->next_reg++;
+}
+
+/* 变量所在的寄存器，第一次出现时生成加载指令 */
+static int alloc_var_reg(RegCompiler *compiler, const char *name) {
+    int slot = bind_variable_slot(compiler->ctx, name);
+    for (int i = 0; i < compiler->var_count; i++) {
+        if (compiler->var_slots[i] == slot) {
+            return compiler->var_regs[i];
+        }
+    }
+    
+    // 变量寄存器在整个表达式中保持有效，不放回空闲列表
+    int reg = alloc_reg(compiler);
+    
+    RegInstruction instr;
+    instr.op = ROP_LOAD_VAR;
+    instr.dst = reg;
+    instr.data.slot = slot;
+    add_reg_instruction(compiler->reg_expr, instr);
+    
+    compiler->var_slots[compiler->var_count] = slot;
+    compiler->var_regs[compiler->var_count++] = reg;
+    return reg;
+}
+
+/* 编译一个节点，返回结果所在的寄存器；*is_temp表示它是否为可重用的临时寄存器 */
+static int compile_reg_node(RegCompiler *compiler, ExprNode *node, int *is_temp) {
+    *is_temp = 0;
+    
+    switch (node->type) {
+        case NODE_CONST:
+            return alloc_const_reg(compiler->reg_expr, node->data.value);
+        
+        case NODE_VAR:
+            return alloc_var_reg(compiler, node->data.var_name);
+        
+        case NODE_ADD:
+        case NODE_SUB:
+        case NODE_MUL:
+        case NODE_DIV: {
+            int left_temp, right_temp;
+            int left = compile_reg_node(compiler, node->data.op.left, &left_temp);
+            int right = compile_reg_node(compiler, node->data.op.right, &right_temp);
+            
+            // 操作数在写入结果之前读取，因此结果可以直接写入刚释放的临时寄存器
+            if (right_temp) {
+                compiler->free_regs[compiler->free_count++] = right;
+            }
+            if (left_temp) {
+                compiler->free_regs[compiler->free_count++] = left;
+            }
+            
+            RegInstruction instr;
+            switch (node->type) {
+                case NODE_ADD:
+                    instr.op = ROP_ADD;
+                    break;
+                case NODE_SUB:
+                    instr.op = ROP_SUB;
+                    break;
+                case NODE_MUL:
+                    instr.op = ROP_MUL;
+                    break;
+                default:
+                    instr.op = ROP_DIV;
+                    break;
+            }
+            instr.dst = alloc_reg(compiler);
+            instr.data.src.left = left;
+            instr.data.src.right = right;
+            add_reg_instruction(compiler->reg_expr, instr);
+            
+            *is_temp = 1;
+            return instr.dst;
+        }
+        
+        default:
+            fprintf(stderr, "未知节点类型\n");
+            exit(1);
+    }
+}
+
+/* 把编译期的寄存器编号换成最终编号：常量在前，其余寄存器在后 */
+static int final_reg(RegExpr *reg_expr, int reg) {
+    return reg < 0 ? -reg - 1 : reg_expr->const_count + reg;
+}
+
+/* 将表达式树编译为寄存器表达式，变量在编译时绑定到ctx中的槽位 */
+void compile_tree_to_reg(ExprNode *node, RegExpr *reg_expr, Context *ctx) {
+    if (!node) return;
+    
+    RegCompiler compiler;
+    compiler.reg_expr = reg_expr;
+    compiler.ctx = ctx;
+    compiler.next_reg = 0;
+    compiler.free_count = 0;
+    compiler.var_count = 0;
+    
+    int is_temp;
+    int result = compile_reg_node(&compiler, node, &is_temp);
+    
+    // alloc_reg只按当时的常量数检查，之后新增的常量可能使总数超限
+    if (reg_expr->const_count + compiler.next_reg > REG_MAX_REGISTERS) {
+        fprintf(stderr, "表达式需要的寄存器过多\n");
+        exit(1);
+    }
+    
+    // 重新编号寄存器
+    for (int i = 0; i < reg_expr->count; i++) {
+        RegInstruction *instr = &reg_expr->instructions[i];
+        instr->dst = final_reg(reg_expr, instr->dst);
+        if (instr->op != ROP_LOAD_VAR) {
+            instr->data.src.left = final_reg(reg_expr, instr->data.src.left);
+            instr->data.src.right = final_reg(reg_expr, instr->data.src.right);
+        }
+    }
+    reg_expr->result_reg = final_reg(reg_expr, result);
+    reg_expr->reg_count = reg_expr->const_count + compiler.next_reg;
+}
+
+/* 基于寄存器的表达式计算 */
+double evaluate_reg(RegExpr *reg_expr, Context *ctx) {
+    if (!reg_expr || reg_expr->reg_count == 0) {
+        return 0.0;
+    }
+    
+    // 寄存器文件，常量预先放在开头
+    double regs[REG_MAX_REGISTERS];
+    memcpy(regs, reg_expr->constants, sizeof(double) * reg_expr->const_count);
+    const double *vars = ctx->values;
+    
+    for (int i = 0; i < reg_expr->count; i++) {
+        RegInstruction *instr = &reg_expr->instructions[i];
+        
+        switch (instr->op) {
+            case ROP_LOAD_VAR:
+                regs[instr->dst] = vars[instr->data.slot];
+                break;
+                
+            case ROP_ADD:
+                regs[instr->dst] = regs[instr->data.src.left] + regs[instr->data.src.right];
+                break;
+                
+            case ROP_SUB:
+                regs[instr->dst] = regs[instr->data.src.left] - regs[instr->data.src.right];
+                break;
+                
+            case ROP_MUL:
+                regs[instr->dst] = regs[instr->data.src.left] * regs[instr->data.src.right];
+                break;
+                
+            case ROP_DIV: {
+                double b = regs[instr->data.src.right];
+                if (b == 0.0) {
+                    fprintf(stderr, "除零错误\n");
+                    return 0.0;
+                }
+                regs[instr->dst] = regs[instr->data.src.left] / b;
+                break;
+            }
+        }
+    }
+    
+    return regs[reg_expr->result_reg];
+}
+
+/* 释放寄存器表达式 */
+void free_reg_expr(RegExpr *reg_expr) {
+    if (reg_expr) {
+        if (reg_expr->instructions) {
+            free(reg_expr->instructions);
+        }
+        if (reg_expr->constants) {
+            free(reg_expr->constants);
+        }
+        free(reg_expr);
+    }
+}
+
+/* 打印寄存器表达式 */
+void print_reg_expr(RegExpr *reg_expr) {
+    if (!reg_expr) return;
+    
+    printf("寄存器表达式 (指令数: %d, 寄存器数: %d):\n", reg_expr->count, reg_expr->reg_count);
+    if (reg_expr->const_count > 0) {
+        printf("  常量:");
+        for (int i = 0; i < reg_expr->const_count; i++) {
+            printf(" r%d=%.2f", i, reg_expr->constants[i]);
+        }
+        printf("\n");
+    }
+    
+    for (int i = 0; i < reg_expr->count; i++) {
+        RegInstruction *instr = &reg_expr->instructions[i];
+        printf("  %d: ", i);
+        
+        switch (instr->op) {
+            case ROP_LOAD_VAR:
+                printf("LOAD_VAR r%d, [%d]", instr->dst, instr->data.slot);
+                break;
+                
+            case ROP_ADD:
+                printf("ADD r%d, r%d, r%d", instr->dst, instr->data.src.left, instr->data.src.right);
+                break;
+                
+            case ROP_SUB:
+                printf("SUB r%d, r%d, r%d", instr->dst, instr->data.src.left, instr->data.src.right);
+                break;
+                
+            case ROP_MUL:
+                printf("MUL r%d, r%d, r%d", instr->dst, instr->data.src.left, instr->data.src.right);
+                break;
+                
+            case ROP_DIV:
+                printf("DIV r%d, r%d, r%d", instr->dst, instr->data.src.left, instr->data.src.right);
+                break;
+        }
+        printf("\n");
+    }
+    printf("  结果: r%d\n", reg_expr->result_reg);
+}
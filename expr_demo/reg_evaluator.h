@@ -0,0 +1,58 @@
+#ifndef REG_EVALUATOR_H
+#define REG_EVALUATOR_H
+
+#include "expr_tree.h"
+
+/* 寄存器文件的最大寄存器数 */
+#define REG_MAX_REGISTERS 1000
+
+/* 寄存器指令操作码 */
+typedef enum {
+    ROP_LOAD_VAR,     // 按槽位加载变量到寄存器
+    ROP_ADD,          // 加法
+    ROP_SUB,          // 减法
+    ROP_MUL,          // 乘法
+    ROP_DIV           // 除法
+} RegOpCode;
+
+/* 寄存器指令: dst = left op right */
+typedef struct {
+    RegOpCode op;
+    int dst;               // 目标寄存器
+    union {
+        struct {
+            int left;      // 左操作数寄存器
+            int right;     // 右操作数寄存器
+        } src;
+        int slot;          // 变量槽位
+    } data;
+} RegInstruction;
+
+/* 寄存器表达式 */
+typedef struct {
+    RegInstruction *instructions;
+    int count;
+    int capacity;
+    double *constants;     // 常量，求值时放在寄存器0..const_count-1中
+    int const_count;
+    int const_capacity;
+    int reg_count;         // 使用的寄存器总数（含常量）
+    int result_reg;        // 结果所在的寄存器
+} RegExpr;
+
+/* 创建寄存器表达式 */
+RegExpr* create_reg_expr(int initial_capacity);
+
+/* 将表达式树编译为寄存器表达式，变量在编译时绑定到ctx中的槽位 */
+void compile_tree_to_reg(ExprNode *node, RegExpr *reg_expr, Context *ctx);
+
+/* 基于寄存器的表达式计算 */
+double evaluate_reg(RegExpr *reg_expr, Context *ctx);
+
+/* 释放寄存器表达式 */
+void free_reg_expr(RegExpr *reg_expr);
+
+/* 打印寄存器表达式 */
+void print_reg_expr(RegExpr *reg_expr);
+
+#endif /* REG_EVALUATOR_H */
@@ -0,0 +1,635 @@
+#include "typed_evaluator.h"
+
+/* 编译期表示NULL常量尚未确定的类型，由另一个操作数决定 */
+#define TYPE_UNKNOWN (-1)
+
+/* 创建带类型的扁平化表达式 */
+TypedExpr* create_typed_expr(int initial_capacity) {
+    TypedExpr *typed_expr = (TypedExpr*)malloc(sizeof(TypedExpr));
+    if (!typed_expr) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    
+    typed_expr->instructions = (TypedInstruction*)malloc(sizeof(TypedInstruction) * initial_capacity);
+    if (!typed_expr->instructions) {
+        fprintf(stderr, "内存分配失败\n");
+        free(typed_expr);
+        exit(1);
+    }
+    
+    typed_expr->count = 0;
+    typed_expr->capacity = initial_capacity;
+    typed_expr->result_type = TYPE_DOUBLE;
+    
+    return typed_expr;
+}
+
+/* 添加指令 */
+static void add_typed_instruction(TypedExpr *typed_expr, TypedInstruction instr) {
+    if (typed_expr->count >= typed_expr->capacity) {
+        int new_capacity = typed_expr->capacity * 2;
+        typed_expr->instructions = (TypedInstruction*)realloc(
+            typed_expr->instructions, sizeof(TypedInstruction) * new_capacity);
+        if (!typed_expr->instructions) {
+            fprintf(stderr, "内存重分配失败\n");
+            exit(1);
+        }
+        typed_expr->capacity = new_capacity;
+    }
+    
+    typed_expr->instructions[typed_expr->count++] = instr;
+}
+
+static int is_arith_node(NodeType type) {
+    return type >= NODE_ADD && type <= NODE_DIV;
+}
+
+/*
+ * 二元运算的操作数类型：NULL常量取另一个操作数的类型，整数与double混合时
+ * 提升为double；两边都是NULL常量时返回TYPE_UNKNOWN
+ */
+static int operand_type(int left, int right) {
+    if (left == TYPE_UNKNOWN) {
+        return right;
+    }
+    if (right == TYPE_UNKNOWN || left == right) {
+        return left;
+    }
+    return TYPE_DOUBLE;
+}
+
+/* 推导节点的类型，类型错误时输出错误信息并返回-2 */
+static int infer_type(ExprNode *node, Context *ctx) {
+    switch (node->type) {
+        case NODE_CONST:
+            return TYPE_DOUBLE;
+        case NODE_INT_CONST:
+            return TYPE_INT64;
+        case NODE_BOOL_CONST:
+            return TYPE_BOOL;
+        case NODE_NULL:
+            return TYPE_UNKNOWN;
+        case NODE_VAR:
+            return ctx->types[bind_variable_slot(ctx, node->data.var_name)];
+        default:
+            break;
+    }
+    
+    if (!is_op_node(node)) {
+        fprintf(stderr, "未知节点类型\n");
+        return -2;
+    }
+    
+    int left = infer_type(node->data.op.left, ctx);
+    int right = infer_type(node->data.op.right, ctx);
+    if (left == -2 || right == -2) {
+        return -2;
+    }
+    
+    if (is_arith_node(node->type)) {
+        if (left == TYPE_BOOL || right == TYPE_BOOL) {
+            fprintf(stderr, "类型错误: 布尔值不能参与算术运算\n");
+            return -2;
+        }
+        return operand_type(left, right);
+    }
+    
+    if (node->type == NODE_AND || node->type == NODE_OR) {
+        if ((left != TYPE_BOOL && left != TYPE_UNKNOWN) ||
+            (right != TYPE_BOOL && right != TYPE_UNKNOWN)) {
+            fprintf(stderr, "类型错误: %s的操作数必须是布尔值\n",
+                    node->type == NODE_AND ? "AND" : "OR");
+            return -2;
+        }
+        return TYPE_BOOL;
+    }
+    
+    // 比较: 布尔值只能与布尔值比较是否相等
+    if (left == TYPE_BOOL || right == TYPE_BOOL) {
+        int other = left == TYPE_BOOL ? right : left;
+        if (other != TYPE_BOOL && other != TYPE_UNKNOWN) {
+            fprintf(stderr, "类型错误: 布尔值不能与%s比较\n", value_type_name((ValueType)other));
+            return -2;
+        }
+        if (node->type != NODE_EQ && node->type != NODE_NE) {
+            fprintf(stderr, "类型错误: 布尔值只能比较是否相等\n");
+            return -2;
+        }
+    }
+    return TYPE_BOOL;
+}
+
+static int emit_typed_node(ExprNode *node, TypedExpr *typed_expr, Context *ctx);
+
+/* 统计同一种逻辑运算连接起来的项数 */
+static int count_logic_terms(ExprNode *node, NodeType type) {
+    if (node->type != type) {
+        return 1;
+    }
+    return count_logic_terms(node->data.op.left, type) +
+           count_logic_terms(node->data.op.right, type);
+}
+
+/* 按从左到右的顺序收集逻辑运算的各项 */
+static void collect_logic_terms(ExprNode *node, NodeType type, ExprNode **terms, int *count) {
+    if (node->type != type) {
+        terms[(*count)++] = node;
+        return;
+    }
+    collect_logic_terms(node->data.op.left, type, terms, count);
+    collect_logic_terms(node->data.op.right, type, terms, count);
+}
+
+/*
+ * 生成AND/OR链，(a AND b) AND c 与 a AND (b AND c) 一样展开成一条链，
+ * 所有条件跳转都直接跳到链的末尾
+ */
+static void emit_logic_chain(ExprNode *node, TypedExpr *typed_expr, Context *ctx) {
+    NodeType type = node->type;
+    int term_count = count_logic_terms(node, type);
+    ExprNode **terms = (ExprNode**)malloc(sizeof(ExprNode*) * term_count);
+    int *jumps = (int*)malloc(sizeof(int) * term_count);
+    if (!terms || !jumps) {
+        fprintf(stderr, "内存分配失败\n");
+        exit(1);
+    }
+    
+    int count = 0;
+    collect_logic_terms(node, type, terms, &count);
+    
+    TypedInstruction instr;
+    memset(&instr, 0, sizeof(instr));
+    
+    emit_typed_node(terms[0], typed_expr, ctx);
+    for (int i = 1; i < term_count; i++) {
+        instr.op = type == NODE_AND ? TOP_JUMP_IF_FALSE : TOP_JUMP_IF_TRUE;
+        jumps[i] = typed_expr->count;
+        add_typed_instruction(typed_expr, instr);
+        
+        emit_typed_node(terms[i], typed_expr, ctx);
+        
+        instr.op = type == NODE_AND ? TOP_AND_BOOL : TOP_OR_BOOL;
+        add_typed_instruction(typed_expr, instr);
+    }
+    
+    // 回填跳转目标
+    for (int i = 1; i < term_count; i++) {
+        typed_expr->instructions[jumps[i]].data.target = typed_expr->count;
+    }
+    
+    free(terms);
+    free(jumps);
+}
+
+/* 生成操作数，需要时转换为double；整数常量在编译时直接转换 */
+static void emit_operand(ExprNode *node, int to_double, TypedExpr *typed_expr, Context *ctx) {
+    TypedInstruction instr;
+    memset(&instr, 0, sizeof(instr));
+    
+    if (to_double && node->type == NODE_INT_CONST) {
+        instr.op = TOP_LOAD_CONST;
+        instr.type = TYPE_DOUBLE;
+        instr.data.value.data.d = (double)node->data.int_value;
+        add_typed_instruction(typed_expr, instr);
+        return;
+    }
+    
+    emit_typed_node(node, typed_expr, ctx);
+    if (to_double) {
+        instr.op = TOP_INT64_TO_DOUBLE;
+        add_typed_instruction(typed_expr, instr);
+    }
+}
+
+/* 按推导出的类型生成指令，返回节点的类型 */
+static int emit_typed_node(ExprNode *node, TypedExpr *typed_expr, Context *ctx) {
+    TypedInstruction instr;
+    memset(&instr, 0, sizeof(instr));
+    
+    switch (node->type) {
+        case NODE_CONST:
+        case NODE_INT_CONST:
+        case NODE_BOOL_CONST:
+        case NODE_NULL:
+            instr.op = TOP_LOAD_CONST;
+            if (node->type == NODE_CONST) {
+                instr.type = TYPE_DOUBLE;
+                instr.data.value.data.d = node->data.value;
+            } else if (node->type == NODE_INT_CONST) {
+                instr.type = TYPE_INT64;
+                instr.data.value.data.i = node->data.int_value;
+            } else if (node->type == NODE_BOOL_CONST) {
+                instr.type = TYPE_BOOL;
+                instr.data.value.data.b = node->data.bool_value;
+            } else {
+                instr.type = TYPE_DOUBLE;
+                instr.data.value.is_null = 1;
+            }
+            add_typed_instruction(typed_expr, instr);
+            return node->type == NODE_NULL ? TYPE_UNKNOWN : (int)instr.type;
+        
+        case NODE_VAR: {
+            int slot = bind_variable_slot(ctx, node->data.var_name);
+            switch (ctx->types[slot]) {
+                case TYPE_INT64:
+                    instr.op = TOP_LOAD_VAR_INT64;
+                    break;
+                case TYPE_BOOL:
+                    instr.op = TOP_LOAD_VAR_BOOL;
+                    break;
+                default:
+                    instr.op = TOP_LOAD_VAR_DOUBLE;
+                    break;
+            }
+            instr.data.slot = slot;
+            add_typed_instruction(typed_expr, instr);
+            return ctx->types[slot];
+        }
+        
+        default:
+            break;
+    }
+    
+    if (node->type == NODE_AND || node->type == NODE_OR) {
+        emit_logic_chain(node, typed_expr, ctx);
+        return TYPE_BOOL;
+    }
+    
+    // 先推导两边的类型，才能在较窄的一边之后插入转换
+    int left = infer_type(node->data.op.left, ctx);
+    int right = infer_type(node->data.op.right, ctx);
+    int type = operand_type(left, right);
+    
+    emit_operand(node->data.op.left, type == TYPE_DOUBLE && left == TYPE_INT64, typed_expr, ctx);
+    emit_operand(node->data.op.right, type == TYPE_DOUBLE && right == TYPE_INT64, typed_expr, ctx);
+    
+    // 操作码按 加减乘除 / 六种比较 的顺序排列，用相对NODE_ADD、NODE_LT的偏移选取
+    if (is_arith_node(node->type)) {
+        TypedOpCode base = type == TYPE_INT64 ? TOP_ADD_INT64 : TOP_ADD_DOUBLE;
+        instr.op = (TypedOpCode)(base + (node->type - NODE_ADD));
+        add_typed_instruction(typed_expr, instr);
+        return type;
+    }
+    
+    if (type == TYPE_BOOL) {
+        instr.op = node->type == NODE_EQ ? TOP_CMP_EQ_BOOL : TOP_CMP_NE_BOOL;
+    } else {
+        TypedOpCode base = type == TYPE_INT64 ? TOP_CMP_LT_INT64 : TOP_CMP_LT_DOUBLE;
+        instr.op = (TypedOpCode)(base + (node->type - NODE_LT));
+    }
+    add_typed_instruction(typed_expr, instr);
+    return TYPE_BOOL;
+}
+
+/* 类型检查并编译表达式树 */
+int compile_tree_to_typed(ExprNode *node, TypedExpr *typed_expr, Context *ctx) {
+    if (!node) return -1;
+    
+    int type = infer_type(node, ctx);
+    if (type == -2) {
+        return -1;
+    }
+    
+    emit_typed_node(node, typed_expr, ctx);
+    typed_expr->result_type = type == TYPE_UNKNOWN ? TYPE_DOUBLE : (ValueType)type;
+    return 0;
+}
+
+static Value null_value(void) {
+    Value value;
+    value.data.i = 0;
+    value.is_null = 1;
+    return value;
+}
+
+/* 弹出右操作数b，a指向左操作数（也是结果的位置）；任一为NULL时结果为NULL */
+#define TYPED_BINARY_OPERANDS() \
+    Value b = stack[stack_top--]; \
+    Value *a = &stack[stack_top]; \
+    if (a->is_null || b.is_null) { \
+        a->is_null = 1; \
+        break; \
+    }
+
+/* 计算带类型的表达式 */
+Value evaluate_typed(TypedExpr *typed_expr, Context *ctx) {
+    if (!typed_expr || typed_expr->count == 0) {
+        return null_value();
+    }
+    
+    Value stack[1000];
+    int stack_top = -1;
+    
+    int pc = 0;
+    while (pc < typed_expr->count) {
+        TypedInstruction *instr = &typed_expr->instructions[pc++];
+        
+        switch (instr->op) {
+            case TOP_LOAD_CONST:
+                stack[++stack_top] = instr->data.value;
+                break;
+                
+            case TOP_LOAD_VAR_DOUBLE:
+                stack_top++;
+                stack[stack_top].data.d = ctx->values[instr->data.slot];
+                stack[stack_top].is_null = ctx->nulls[instr->data.slot];
+                break;
+                
+            case TOP_LOAD_VAR_INT64:
+                stack_top++;
+                stack[stack_top].data.i = ctx->ints[instr->data.slot];
+                stack[stack_top].is_null = ctx->nulls[instr->data.slot];
+                break;
+                
+            case TOP_LOAD_VAR_BOOL:
+                stack_top++;
+                stack[stack_top].data.b = ctx->ints[instr->data.slot] != 0;
+                stack[stack_top].is_null = ctx->nulls[instr->data.slot];
+                break;
+                
+            case TOP_INT64_TO_DOUBLE:
+                stack[stack_top].data.d = (double)stack[stack_top].data.i;
+                break;
+                
+            case TOP_ADD_INT64: {
+                TYPED_BINARY_OPERANDS();
+                if (__builtin_add_overflow(a->data.i, b.data.i, &a->data.i)) {
+                    fprintf(stderr, "整数溢出\n");
+                    return null_value();
+                }
+                break;
+            }
+            
+            case TOP_SUB_INT64: {
+                TYPED_BINARY_OPERANDS();
+                if (__builtin_sub_overflow(a->data.i, b.data.i, &a->data.i)) {
+                    fprintf(stderr, "整数溢出\n");
+                    return null_value();
+                }
+                break;
+            }
+            
+            case TOP_MUL_INT64: {
+                TYPED_BINARY_OPERANDS();
+                if (__builtin_mul_overflow(a->data.i, b.data.i, &a->data.i)) {
+                    fprintf(stderr, "整数溢出\n");
+                    return null_value();
+                }
+                break;
+            }
+            
+            case TOP_DIV_INT64: {
+                TYPED_BINARY_OPERANDS();
+                if (b.data.i == 0) {
+                    fprintf(stderr, "除零错误\n");
+                    return null_value();
+                }
+                if (b.data.i == -1 && a->data.i == INT64_MIN) {
+                    fprintf(stderr, "整数溢出\n");
+                    return null_value();
+                }
+                a->data.i /= b.data.i;
+                break;
+            }
+            
+            case TOP_ADD_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.d += b.data.d;
+                break;
+            }
+            
+            case TOP_SUB_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.d -= b.data.d;
+                break;
+            }
+            
+            case TOP_MUL_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.d *= b.data.d;
+                break;
+            }
+            
+            case TOP_DIV_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                if (b.data.d == 0.0) {
+                    fprintf(stderr, "除零错误\n");
+                    return null_value();
+                }
+                a->data.d /= b.data.d;
+                break;
+            }
+            
+            case TOP_CMP_LT_INT64: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.i < b.data.i;
+                break;
+            }
+            
+            case TOP_CMP_LE_INT64: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.i <= b.data.i;
+                break;
+            }
+            
+            case TOP_CMP_GT_INT64: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.i > b.data.i;
+                break;
+            }
+            
+            case TOP_CMP_GE_INT64: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.i >= b.data.i;
+                break;
+            }
+            
+            case TOP_CMP_EQ_INT64: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.i == b.data.i;
+                break;
+            }
+            
+            case TOP_CMP_NE_INT64: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.i != b.data.i;
+                break;
+            }
+            
+            case TOP_CMP_LT_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.d < b.data.d;
+                break;
+            }
+            
+            case TOP_CMP_LE_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.d <= b.data.d;
+                break;
+            }
+            
+            case TOP_CMP_GT_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.d > b.data.d;
+                break;
+            }
+            
+            case TOP_CMP_GE_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.d >= b.data.d;
+                break;
+            }
+            
+            case TOP_CMP_EQ_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.d == b.data.d;
+                break;
+            }
+            
+            case TOP_CMP_NE_DOUBLE: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.d != b.data.d;
+                break;
+            }
+            
+            case TOP_CMP_EQ_BOOL: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.b == b.data.b;
+                break;
+            }
+            
+            case TOP_CMP_NE_BOOL: {
+                TYPED_BINARY_OPERANDS();
+                a->data.b = a->data.b != b.data.b;
+                break;
+            }
+            
+            case TOP_AND_BOOL: {
+                // 不能用TYPED_BINARY_OPERANDS: NULL AND false 为false
+                Value b = stack[stack_top--];
+                Value *a = &stack[stack_top];
+                if ((!a->is_null && !a->data.b) || (!b.is_null && !b.data.b)) {
+                    a->is_null = 0;
+                    a->data.b = 0;
+                } else if (a->is_null || b.is_null) {
+                    a->is_null = 1;
+                } else {
+                    a->data.b = 1;
+                }
+                break;
+            }
+            
+            case TOP_OR_BOOL: {
+                // NULL OR true 为true
+                Value b = stack[stack_top--];
+                Value *a = &stack[stack_top];
+                if ((!a->is_null && a->data.b) || (!b.is_null && b.data.b)) {
+                    a->is_null = 0;
+                    a->data.b = 1;
+                } else if (a->is_null || b.is_null) {
+                    a->is_null = 1;
+                } else {
+                    a->data.b = 0;
+                }
+                break;
+            }
+            
+            case TOP_JUMP_IF_FALSE:
+                if (!stack[stack_top].is_null && !stack[stack_top].data.b) {
+                    pc = instr->data.target;
+                }
+                break;
+                
+            case TOP_JUMP_IF_TRUE:
+                if (!stack[stack_top].is_null && stack[stack_top].data.b) {
+                    pc = instr->data.target;
+                }
+                break;
+        }
+    }
+    
+    // 栈顶元素应该是最终结果
+    if (stack_top != 0) {
+        fprintf(stderr, "表达式计算错误，栈不平衡\n");
+        return null_value();
+    }
+    
+    return stack[0];
+}
+
+/* 释放带类型的扁平化表达式 */
+void free_typed_expr(TypedExpr *typed_expr) {
+    if (typed_expr) {
+        if (typed_expr->instructions) {
+            free(typed_expr->instructions);
+        }
+        free(typed_expr);
+    }
+}
+
+/* 类型名称 */
+const char* value_type_name(ValueType type) {
+    switch (type) {
+        case TYPE_INT64:
+            return "int64";
+        case TYPE_BOOL:
+            return "bool";
+        default:
+            return "double";
+    }
+}
+
+/* 按类型打印一个值 */
+void print_value(Value value, ValueType type) {
+    if (value.is_null) {
+        printf("NULL");
+        return;
+    }
+    
+    switch (type) {
+        case TYPE_INT64:
+            printf("%lld", (long long)value.data.i);
+            break;
+        case TYPE_BOOL:
+            printf("%s", value.data.b ? "true" : "false");
+            break;
+        default:
+            printf("%.6f", value.data.d);
+            break;
+    }
+}
+
+/* 打印带类型的扁平化表达式 */
+void print_typed_expr(TypedExpr *typed_expr) {
+    // 下标与TypedOpCode一一对应
+    static const char *const names[] = {
+        "LOAD_CONST", "LOAD_VAR_DOUBLE", "LOAD_VAR_INT64", "LOAD_VAR_BOOL", "INT64_TO_DOUBLE",
+        "ADD_INT64", "SUB_INT64", "MUL_INT64", "DIV_INT64",
+        "ADD_DOUBLE", "SUB_DOUBLE", "MUL_DOUBLE", "DIV_DOUBLE",
+        "CMP_LT_INT64", "CMP_LE_INT64", "CMP_GT_INT64", "CMP_GE_INT64", "CMP_EQ_INT64", "CMP_NE_INT64",
+        "CMP_LT_DOUBLE", "CMP_LE_DOUBLE", "CMP_GT_DOUBLE", "CMP_GE_DOUBLE", "CMP_EQ_DOUBLE", "CMP_NE_DOUBLE",
+        "CMP_EQ_BOOL", "CMP_NE_BOOL",
+        "AND_BOOL", "OR_BOOL", "JUMP_IF_FALSE", "JUMP_IF_TRUE"
+    };
+    
+    if (!typed_expr) return;
+    
+    printf("带类型的表达式 (指令数: %d, 结果类型: %s):\n",
+           typed_expr->count, value_type_name(typed_expr->result_type));
+    for (int i = 0; i < typed_expr->count; i++) {
+        TypedInstruction *instr = &typed_expr->instructions[i];
+        printf("  %d: %s", i, names[instr->op]);
+        
+        if (instr->op == TOP_LOAD_CONST) {
+            printf(" ");
+            print_value(instr->data.value, instr->type);
+        } else if (instr->op == TOP_LOAD_VAR_DOUBLE || instr->op == TOP_LOAD_VAR_INT64 ||
+                   instr->op == TOP_LOAD_VAR_BOOL) {
+            printf(" [%d]", instr->data.slot);
+        } else if (instr->op == TOP_JUMP_IF_FALSE || instr->op == TOP_JUMP_IF_TRUE) {
+            printf(" -> %d", instr->data.target);
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef TYPED_EVALUATOR_H
+#define TYPED_EVALUATOR_H
+
+#include "expr_tree.h"
+
+/*
+ * 带类型的操作码
+ *
+ * 操作数类型在编译时确定，每种类型组合有自己的操作码，求值时不再按类型
+ * 分派。整数与double混合运算时，编译器在整数操作数后面插入
+ * TOP_INT64_TO_DOUBLE。除TOP_LOAD_*和逻辑运算外，任一操作数为NULL时结果为NULL。
+ *
+ * AND/OR按SQL三值逻辑计算，并且短路求值：a AND b AND c 编译为
+ *   <a> JUMP_IF_FALSE end <b> AND_BOOL JUMP_IF_FALSE end <c> AND_BOOL end:
+ * 条件跳转只检查栈顶而不弹出，跳转时栈顶就是整个表达式的结果，后面的项
+ * 不再计算。栈顶为NULL时不跳转，因为后面的项为false时结果仍是false。
+ */
+typedef enum {
+    TOP_LOAD_CONST,        // 加载常量（可以是NULL）
+    TOP_LOAD_VAR_DOUBLE,   // 加载double变量
+    TOP_LOAD_VAR_INT64,    // 加载整数变量
+    TOP_LOAD_VAR_BOOL,     // 加载布尔变量
+    TOP_INT64_TO_DOUBLE,   // 栈顶整数转换为double
+    TOP_ADD_INT64,
+    TOP_SUB_INT64,
+    TOP_MUL_INT64,
+    TOP_DIV_INT64,         // 整数除法，向零取整
+    TOP_ADD_DOUBLE,
+    TOP_SUB_DOUBLE,
+    TOP_MUL_DOUBLE,
+    TOP_DIV_DOUBLE,
+    TOP_CMP_LT_INT64,
+    TOP_CMP_LE_INT64,
+    TOP_CMP_GT_INT64,
+    TOP_CMP_GE_INT64,
+    TOP_CMP_EQ_INT64,
+    TOP_CMP_NE_INT64,
+    TOP_CMP_LT_DOUBLE,
+    TOP_CMP_LE_DOUBLE,
+    TOP_CMP_GT_DOUBLE,
+    TOP_CMP_GE_DOUBLE,
+    TOP_CMP_EQ_DOUBLE,
+    TOP_CMP_NE_DOUBLE,
+    TOP_CMP_EQ_BOOL,
+    TOP_CMP_NE_BOOL,
+    TOP_AND_BOOL,          // 三值逻辑与
+    TOP_OR_BOOL,           // 三值逻辑或
+    TOP_JUMP_IF_FALSE,     // 栈顶为false（不是NULL）时跳转，不弹出
+    TOP_JUMP_IF_TRUE       // 栈顶为true时跳转，不弹出
+} TypedOpCode;
+
+/* 带类型的指令 */
+typedef struct {
+    TypedOpCode op;
+    ValueType type;        // TOP_LOAD_CONST的常量类型，用于打印
+    union {
+        Value value;       // 常量
+        int slot;          // 变量槽位
+        int target;        // 跳转目标的指令下标
+    } data;
+} TypedInstruction;
+
+/* 带类型的扁平化表达式 */
+typedef struct {
+    TypedInstruction *instructions;
+    int count;
+    int capacity;
+    ValueType result_type; // 表达式结果的类型
+} TypedExpr;
+
+/* 创建带类型的扁平化表达式 */
+TypedExpr* create_typed_expr(int initial_capacity);
+
+/*
+ * 类型检查并编译表达式树
+ *
+ * 变量的类型取自ctx中绑定的槽位，因此变量要在编译前设置好类型。
+ * 算术运算的两个操作数都是整数时结果为整数，否则为double；布尔值不能参与
+ * 算术运算，只能与布尔值比较是否相等；AND/OR的操作数必须是布尔值。
+ * NULL常量取另一个操作数的类型。
+ * 类型错误时输出错误信息并返回-1，成功返回0。
+ */
+int compile_tree_to_typed(ExprNode *node, TypedExpr *typed_expr, Context *ctx);
+
+/*
+ * 计算带类型的表达式
+ *
+ * 除零或整数溢出时输出错误信息，结果为NULL。
+ */
+Value evaluate_typed(TypedExpr *typed_expr, Context *ctx);
+
+/* 释放带类型的扁平化表达式 */
+void free_typed_expr(TypedExpr *typed_expr);
+
+/* 打印带类型的扁平化表达式 */
+void print_typed_expr(TypedExpr *typed_expr);
+
+/* 按类型打印一个值 */
+void print_value(Value value, ValueType type);
+
+/* 类型名称 */
+const char* value_type_name(ValueType type);
+
+#endif /* TYPED_EVALUATOR_H */
@@ -0,0 +1,298 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "sharedtuplestore.h"
+
+/* 错误处理函数 */
+static void sts_error(const char *message) {
+    fprintf(stderr, "SharedTuplestore错误: %s\n", message);
+}
+
+/* 存储中的元组数量 */
+static int sts_store_count(TupleStore *store) {
+    return store->using_file ? store->file_count : store->count;
+}
+
+/* 创建共享存储 */
+SharedTuplestore* sts_create(int nparticipants, int max_memory_kb) {
+    // 参数检查
+    if (nparticipants <= 0 || max_memory_kb <= 0) {
+        sts_error("无效的参数");
+        return NULL;
+    }
+    
+    SharedTuplestore *sts = (SharedTuplestore*)calloc(1, sizeof(SharedTuplestore));
+    if (!sts) {
+        sts_error("无法为共享存储分配内存");
+        return NULL;
+    }
+    sts->nparticipants = nparticipants;
+    sts->max_memory_kb = max_memory_kb;
+    atomic_init(&sts->writers_done, 0);
+    atomic_init(&sts->next_chunk, 0);
+    
+    sts->stores = (TupleStore**)calloc(nparticipants, sizeof(TupleStore*));
+    sts->chunk_base = (int*)calloc(nparticipants + 1, sizeof(int));
+    if (!sts->stores || !sts->chunk_base) {
+        sts_error("无法为共享存储分配内存");
+        sts_free(sts);
+        return NULL;
+    }
+    
+    // 每个参与者的存储事先创建好，写入时不需要再修改共享状态
+    for (int i = 0; i < nparticipants; i++) {
+        sts->stores[i] = tuplestore_create(max_memory_kb);
+        if (!sts->stores[i]) {
+            sts_free(sts);
+            return NULL;
+        }
+    }
+    
+    return sts;
+}
+
+/* 以参与者participant的身份附加到共享存储 */
+SharedTuplestoreAccessor* sts_attach(SharedTuplestore *sts, int participant) {
+    // 参数检查
+    if (!sts || participant < 0 || participant >= sts->nparticipants) {
+        sts_error("无效的参数");
+        return NULL;
+    }
+    
+    SharedTuplestoreAccessor *accessor =
+        (SharedTuplestoreAccessor*)calloc(1, sizeof(SharedTuplestoreAccessor));
+    if (!accessor) {
+        sts_error("无法为访问状态分配内存");
+        return NULL;
+    }
+    accessor->sts = sts;
+    accessor->participant = participant;
+    accessor->writing = 1;
+    return accessor;
+}
+
+/* 写入一个元组 */
+int sts_puttuple(SharedTuplestoreAccessor *accessor, int id, const char *data) {
+    // 参数检查
+    if (!accessor || !data) {
+        sts_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (!accessor->writing) {
+        sts_error("该参与者已经结束写入");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    return tuplestore_put(accessor->sts->stores[accessor->participant], id, data);
+}
+
+/* 结束该参与者的写入：把写缓冲区刷新到文件，扫描者才能看到全部元组 */
+int sts_end_write(SharedTuplestoreAccessor *accessor) {
+    // 参数检查
+    if (!accessor) {
+        sts_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (!accessor->writing) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    int result = tuplestore_flush_buffer(accessor->sts->stores[accessor->participant]);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    accessor->writing = 0;
+    atomic_fetch_add(&accessor->sts->writers_done, 1);
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 划分扫描区间
+ *
+ * 每个参与者的元组按STS_SCAN_CHUNK_TUPLES个一组编号，chunk_base记录每个参与者
+ * 第一组的全局编号，扫描者用原子加法领取下一个编号即可确定要读的区间。
+ */
+int sts_begin_parallel_scan(SharedTuplestore *sts) {
+    // 参数检查
+    if (!sts) {
+        sts_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (atomic_load(&sts->writers_done) != sts->nparticipants) {
+        sts_error("还有参与者没有结束写入");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int total = 0;
+    for (int i = 0; i < sts->nparticipants; i++) {
+        int count = sts_store_count(sts->stores[i]);
+        sts->chunk_base[i] = total;
+        total += (count + STS_SCAN_CHUNK_TUPLES - 1) / STS_SCAN_CHUNK_TUPLES;
+    }
+    sts->chunk_base[sts->nparticipants] = total;
+    sts->total_chunks = total;
+    atomic_store(&sts->next_chunk, 0);
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 领取下一个扫描区间，返回1表示领到区间，0表示没有剩余区间，负值为错误码
+ *
+ * 文件中的区间用pread一次读入访问者自己的缓冲区：pread不使用共享的文件位置，
+ * 多个扫描者可以同时读同一个临时文件。内存中的区间直接读取元组数组。
+ */
+static int sts_claim_chunk(SharedTuplestoreAccessor *accessor) {
+    SharedTuplestore *sts = accessor->sts;
+    
+    int chunk = atomic_fetch_add(&sts->next_chunk, 1);
+    if (chunk >= sts->total_chunks) {
+        return 0;
+    }
+    
+    // 二分查找区间所属的参与者
+    int lo = 0, hi = sts->nparticipants - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (sts->chunk_base[mid] <= chunk) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    
+    TupleStore *store = sts->stores[lo];
+    int count = sts_store_count(store);
+    accessor->scan_store = store;
+    accessor->scan_pos = (chunk - sts->chunk_base[lo]) * STS_SCAN_CHUNK_TUPLES;
+    accessor->scan_end = accessor->scan_pos + STS_SCAN_CHUNK_TUPLES;
+    if (accessor->scan_end > count) {
+        accessor->scan_end = count;
+    }
+    
+    if (!store->using_file) {
+        return 1;
+    }
+    
+    long start = store->file_offsets[accessor->scan_pos];
+    long end = accessor->scan_end < store->file_count ?
+               store->file_offsets[accessor->scan_end] : store->file_size;
+    size_t bytes = (size_t)(end - start);
+    
+    if (bytes > accessor->read_buffer_size) {
+        char *buffer = (char*)realloc(accessor->read_buffer, bytes);
+        if (!buffer) {
+            sts_error("无法为读缓冲区分配内存");
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        accessor->read_buffer = buffer;
+        accessor->read_buffer_size = bytes;
+    }
+    
+    int fd = fileno(store->temp_file);
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t n = pread(fd, accessor->read_buffer + done, bytes - done, start + (long)done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            sts_error("从临时文件读取元组失败");
+            return TUPLESTORE_ERROR_IO;
+        }
+        done += (size_t)n;
+    }
+    accessor->read_offset = 0;
+    return 1;
+}
+
+/*
+ * 获取下一个元组
+ *
+ * 领取区间出错时这个区间已经被领走，其他扫描者不会再读它，所以不能当作
+ * 扫描结束：错误码记录在accessor->error中，之后一直返回NULL。
+ */
+const Tuple* sts_parallel_scan_next(SharedTuplestoreAccessor *accessor) {
+    // 参数检查
+    if (!accessor) {
+        sts_error("无效的参数");
+        return NULL;
+    }
+    if (accessor->error != TUPLESTORE_SUCCESS) {
+        return NULL;
+    }
+    
+    // 当前区间读完后领取下一个
+    while (!accessor->scan_store || accessor->scan_pos >= accessor->scan_end) {
+        int result = sts_claim_chunk(accessor);
+        if (result <= 0) {
+            accessor->scan_store = NULL;
+            if (result < 0) {
+                accessor->error = result;
+            }
+            return NULL;
+        }
+    }
+    
+    TupleStore *store = accessor->scan_store;
+    accessor->scan_pos++;
+    if (!store->using_file) {
+        return store->tuples[accessor->scan_pos - 1];
+    }
+    
+    const Tuple *tuple = (const Tuple*)(accessor->read_buffer + accessor->read_offset);
+    accessor->read_offset += TUPLE_ALIGN(tuple->t_len);
+    return tuple;
+}
+
+/* 扫描中的错误码 */
+int sts_get_error(SharedTuplestoreAccessor *accessor) {
+    if (!accessor) {
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    return accessor->error;
+}
+
+/* 元组总数 */
+long sts_tuple_count(SharedTuplestore *sts) {
+    if (!sts) {
+        return 0;
+    }
+    
+    long total = 0;
+    for (int i = 0; i < sts->nparticipants; i++) {
+        total += sts_store_count(sts->stores[i]);
+    }
+    return total;
+}
+
+/* 释放访问状态 */
+void sts_detach(SharedTuplestoreAccessor *accessor) {
+    if (!accessor) {
+        return;
+    }
+    free(accessor->read_buffer);
+    free(accessor);
+}
+
+/* 释放共享存储 */
+int sts_free(SharedTuplestore *sts) {
+    if (!sts) {
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int result = TUPLESTORE_SUCCESS;
+    if (sts->stores) {
+        for (int i = 0; i < sts->nparticipants; i++) {
+            if (sts->stores[i] && tuplestore_free(sts->stores[i]) != TUPLESTORE_SUCCESS) {
+                result = TUPLESTORE_ERROR_CLEANUP;
+            }
+        }
+        free(sts->stores);
+    }
+    free(sts->chunk_base);
+    free(sts);
+    return result;
+}
@@ -0,0 +1,79 @@
+#ifndef SHAREDTUPLESTORE_H
+#define SHAREDTUPLESTORE_H
+
+#include <stdatomic.h>
+#include "tuplestore.h"
+
+/**
+ * SharedTuplestore - 多个线程共同写入、共同扫描的元组存储
+ * 参照PostgreSQL并行哈希连接使用的SharedTuplestore
+ *
+ * 每个参与者（线程）写入自己的TupleStore：元组分配在自己的内存块中，
+ * 溢出时写入自己的临时文件，写入路径上没有任何锁。所有参与者结束写入后，
+ * 扫描者通过一个原子计数器领取各参与者数据中的元组区间，并行读取。
+ */
+
+/* 并行扫描时每次领取的元组数 */
+#define STS_SCAN_CHUNK_TUPLES 1024
+
+/* 共享状态 */
+typedef struct {
+    int nparticipants;         /* 参与者数量 */
+    int max_memory_kb;         /* 每个参与者的内存限制(KB) */
+    TupleStore **stores;       /* 每个参与者写入的存储 */
+    atomic_int writers_done;   /* 已经结束写入的参与者数量 */
+
+    /* 并行扫描 */
+    int *chunk_base;           /* 每个参与者的第一个扫描区间的全局编号（前缀和） */
+    int total_chunks;          /* 扫描区间总数 */
+    atomic_int next_chunk;     /* 下一个未被领取的扫描区间 */
+} SharedTuplestore;
+
+/* 每个参与者自己的访问状态，不在线程之间共享 */
+typedef struct {
+    SharedTuplestore *sts;     /* 共享状态 */
+    int participant;           /* 参与者编号 */
+    int writing;               /* 是否还可以写入 */
+
+    /* 当前扫描区间 */
+    TupleStore *scan_store;    /* 区间所属的存储 */
+    int scan_pos;              /* 下一个元组的位置 */
+    int scan_end;              /* 区间结束位置（不含） */
+    char *read_buffer;         /* 从文件读入的区间数据 */
+    size_t read_buffer_size;   /* 读缓冲区容量 */
+    size_t read_offset;        /* 下一个元组在读缓冲区中的偏移 */
+    int error;                 /* 扫描出错时的错误码，否则为TUPLESTORE_SUCCESS */
+} SharedTuplestoreAccessor;
+
+/* 创建共享存储，max_memory_kb是每个参与者的内存限制 */
+SharedTuplestore* sts_create(int nparticipants, int max_memory_kb);
+
+/* 以参与者participant的身份附加到共享存储 */
+SharedTuplestoreAccessor* sts_attach(SharedTuplestore *sts, int participant);
+
+/* 写入一个元组（只访问该参与者自己的存储，不加锁） */
+int sts_puttuple(SharedTuplestoreAccessor *accessor, int id, const char *data);
+
+/* 结束该参与者的写入 */
+int sts_end_write(SharedTuplestoreAccessor *accessor);
+
+/* 划分扫描区间，必须在所有参与者结束写入之后、开始扫描之前由一个线程调用 */
+int sts_begin_parallel_scan(SharedTuplestore *sts);
+
+/* 获取下一个元组（借用，下一次调用前有效），所有扫描者合起来恰好读到每个元组一次；
+ * 扫描结束或出错时返回NULL */
+const Tuple* sts_parallel_scan_next(SharedTuplestoreAccessor *accessor);
+
+/* 扫描中的错误码，sts_parallel_scan_next返回NULL后用它区分出错与扫描结束 */
+int sts_get_error(SharedTuplestoreAccessor *accessor);
+
+/* 元组总数 */
+long sts_tuple_count(SharedTuplestore *sts);
+
+/* 释放访问状态 */
+void sts_detach(SharedTuplestoreAccessor *accessor);
+
+/* 释放共享存储 */
+int sts_free(SharedTuplestore *sts);
+
+#endif /* SHAREDTUPLESTORE_H */
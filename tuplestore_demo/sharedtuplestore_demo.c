@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "sharedtuplestore.h"
+
+#define NWORKERS 4
+#define TUPLES_PER_WORKER 50000
+
+/* 扫描时对每个元组的数据计算哈希的轮数，模拟真实的元组处理开销 */
+#define HASH_ROUNDS 64
+
+/* 每个线程的参数和结果 */
+typedef struct {
+    SharedTuplestoreAccessor *accessor;
+    int worker;
+    long count;
+    long id_sum;
+    unsigned int hash_sum;
+    int result;
+} WorkerArg;
+
+/* 写入线程：每个线程写入自己的元组 */
+static void* producer(void *p) {
+    WorkerArg *arg = (WorkerArg*)p;
+    arg->result = TUPLESTORE_SUCCESS;
+    for (int i = 0; i < TUPLES_PER_WORKER; i++) {
+        char data[64];
+        int id = arg->worker * TUPLES_PER_WORKER + i;
+        snprintf(data, sizeof(data), "线程%d的元组 #%d", arg->worker, i);
+        arg->result = sts_puttuple(arg->accessor, id, data);
+        if (arg->result != TUPLESTORE_SUCCESS) {
+            return NULL;
+        }
+    }
+    arg->result = sts_end_write(arg->accessor);
+    return NULL;
+}
+
+/* 处理一个元组：对数据反复计算FNV-1a哈希 */
+static unsigned int process_tuple(const Tuple *tuple) {
+    unsigned int hash = 2166136261u;
+    for (int round = 0; round < HASH_ROUNDS; round++) {
+        for (const char *c = tuple->data; *c; c++) {
+            hash = (hash ^ (unsigned char)*c) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+/* 扫描线程同时开始，否则先创建的线程可能在其他线程启动前领完所有区间 */
+static pthread_barrier_t scan_barrier;
+
+/* 扫描线程：并行领取区间，合起来读到每个元组一次 */
+static void* consumer(void *p) {
+    WorkerArg *arg = (WorkerArg*)p;
+    const Tuple *tuple;
+    arg->count = 0;
+    arg->id_sum = 0;
+    arg->hash_sum = 0;
+    pthread_barrier_wait(&scan_barrier);
+    while ((tuple = sts_parallel_scan_next(arg->accessor)) != NULL) {
+        arg->count++;
+        arg->id_sum += tuple->id;
+        arg->hash_sum += process_tuple(tuple);
+    }
+    arg->result = sts_get_error(arg->accessor);
+    return NULL;
+}
+
+/**
+ * 示例主函数 - 展示如何使用SharedTuplestore
+ */
+int main() {
+    printf("===== SharedTuplestore 示例 =====\n\n");
+    
+    // 每个参与者的内存限制为256KB，写入量超过后各自溢出到自己的临时文件
+    SharedTuplestore *sts = sts_create(NWORKERS, 256);
+    if (!sts) {
+        printf("创建SharedTuplestore失败\n");
+        return 1;
+    }
+    
+    pthread_t threads[NWORKERS];
+    WorkerArg args[NWORKERS];
+    for (int i = 0; i < NWORKERS; i++) {
+        args[i].accessor = sts_attach(sts, i);
+        args[i].worker = i;
+        if (!args[i].accessor) {
+            printf("附加到SharedTuplestore失败\n");
+            return 1;
+        }
+    }
+    
+    // 并行写入
+    for (int i = 0; i < NWORKERS; i++) {
+        pthread_create(&threads[i], NULL, producer, &args[i]);
+    }
+    for (int i = 0; i < NWORKERS; i++) {
+        pthread_join(threads[i], NULL);
+        if (args[i].result != TUPLESTORE_SUCCESS) {
+            printf("线程%d写入失败，错误代码: %d\n", i, args[i].result);
+            return 1;
+        }
+    }
+    printf("%d 个线程共写入 %ld 个元组\n", NWORKERS, sts_tuple_count(sts));
+    for (int i = 0; i < NWORKERS; i++) {
+        printf("  参与者%d: %s\n", i, sts->stores[i]->using_file ? "已溢出到文件" : "在内存中");
+    }
+    
+    // 并行扫描
+    if (sts_begin_parallel_scan(sts) != TUPLESTORE_SUCCESS) {
+        printf("开始并行扫描失败\n");
+        return 1;
+    }
+    pthread_barrier_init(&scan_barrier, NULL, NWORKERS);
+    for (int i = 0; i < NWORKERS; i++) {
+        pthread_create(&threads[i], NULL, consumer, &args[i]);
+    }
+    long total = 0, id_sum = 0;
+    unsigned int hash_sum = 0;
+    for (int i = 0; i < NWORKERS; i++) {
+        pthread_join(threads[i], NULL);
+        if (args[i].result != TUPLESTORE_SUCCESS) {
+            printf("扫描线程%d读取失败，错误代码: %d\n", i, args[i].result);
+            return 1;
+        }
+        printf("扫描线程%d读取了 %ld 个元组\n", i, args[i].count);
+        total += args[i].count;
+        id_sum += args[i].id_sum;
+        hash_sum += args[i].hash_sum;
+    }
+    pthread_barrier_destroy(&scan_barrier);
+    
+    long n = (long)NWORKERS * TUPLES_PER_WORKER;
+    printf("共读取 %ld 个元组, id之和 %ld (期望 %ld), 数据哈希之和 %08x\n",
+           total, id_sum, n * (n - 1) / 2, hash_sum);
+    
+    for (int i = 0; i < NWORKERS; i++) {
+        sts_detach(args[i].accessor);
+    }
+    int free_result = sts_free(sts);
+    if (free_result != TUPLESTORE_SUCCESS) {
+        printf("警告: 释放 SharedTuplestore 时发生错误，错误代码: %d\n", free_result);
+    }
+    
+    printf("\n===== 示例完成 =====\n");
+    return 0;
+}
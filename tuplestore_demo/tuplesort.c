@@ -0,0 +1,912 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "tuplesort.h"
+
+/* 顺串临时文件名模板 */
+#define TUPLESORT_TEMP_FILE_TEMPLATE "/tmp/tuplesort_XXXXXX"
+
+/* 错误处理函数 */
+static void tuplesort_error(const char *message) {
+    fprintf(stderr, "Tuplesort错误: %s\n", message);
+}
+
+/* 系统调用失败时的错误处理，附带errno的说明 */
+static void tuplesort_io_error(const char *message) {
+    fprintf(stderr, "Tuplesort错误: %s (%s)\n", message, strerror(errno));
+}
+
+/* 按id比较 */
+int tuplesort_compare_id(const Tuple *a, const Tuple *b, void *arg) {
+    (void)arg;
+    return (a->id > b->id) - (a->id < b->id);
+}
+
+/* 按data比较，相同时按id比较 */
+int tuplesort_compare_data(const Tuple *a, const Tuple *b, void *arg) {
+    int result = strcmp(a->data, b->data);
+    if (result != 0) {
+        return result;
+    }
+    return tuplesort_compare_id(a, b, arg);
+}
+
+/* qsort_r使用的比较函数，元素是Tuple指针 */
+static int tuplesort_qsort_compare(const void *a, const void *b, void *arg) {
+    Tuplesortstate *state = (Tuplesortstate*)arg;
+    return state->compare(*(const Tuple* const*)a, *(const Tuple* const*)b, state->compare_arg);
+}
+
+/* 创建一个空的内存存储，内存限制就是work_mem */
+static TupleStore* tuplesort_new_memstore(Tuplesortstate *state) {
+    return tuplestore_create((int)(state->work_mem / 1024));
+}
+
+/*
+ * 判断放入一个stored字节的元组是否需要先写出顺串
+ *
+ * 必须在内存存储自己溢出到文件之前写出顺串，否则文件中的元组是无序的。
+ * 这里按tuplestore_put的顺序估算它将要申请的内存：元组数组满时容量翻倍，
+ * 当前内存块放不下时至少申请一个刚好放下元组的新块（新块大小会被剩余内存截断）。
+ */
+static int tuplesort_lack_memory(Tuplesortstate *state, size_t stored) {
+    TupleStore *store = state->memstore;
+    size_t need = 0;
+    
+    if (store->count == 0) {
+        return 0;
+    }
+    if (store->count >= store->capacity) {
+        need += sizeof(Tuple*) * store->capacity;
+    }
+    if (!store->chunk_tail || store->chunk_tail->size - store->chunk_tail->used < stored) {
+        need += sizeof(TupleChunk) + stored;
+    }
+    return need > 0 && (size_t)store->current_memory + need > state->work_mem;
+}
+
+/* 创建排序状态 */
+Tuplesortstate* tuplesort_begin(int work_mem_kb, TupleCompareFunc compare, void *arg) {
+    // 参数检查
+    if (work_mem_kb <= 0 || work_mem_kb > INT_MAX / 1024 || !compare) {
+        tuplesort_error("无效的参数");
+        return NULL;
+    }
+    
+    Tuplesortstate *state = (Tuplesortstate*)calloc(1, sizeof(Tuplesortstate));
+    if (!state) {
+        tuplesort_error("无法为排序状态分配内存");
+        return NULL;
+    }
+    
+    state->status = TSS_INITIAL;
+    state->compare = compare;
+    state->compare_arg = arg;
+    state->work_mem = (size_t)work_mem_kb * 1024;
+    tuple_slot_init(&state->scratch);
+    state->merger.last = -1;
+    state->tape_fd = -1;
+    
+    // 每个顺串至少分到TUPLESORT_MERGE_BUFFER_SIZE的读缓冲区
+    state->merge_order = (int)(state->work_mem / TUPLESORT_MERGE_BUFFER_SIZE);
+    if (state->merge_order < 2) {
+        state->merge_order = 2;
+    }
+    if (state->merge_order > TUPLESORT_MAX_MERGE_ORDER) {
+        state->merge_order = TUPLESORT_MAX_MERGE_ORDER;
+    }
+    
+    state->memstore = tuplesort_new_memstore(state);
+    if (!state->memstore) {
+        free(state);
+        return NULL;
+    }
+    
+    return state;
+}
+
+/* 设置只需要最小的bound个元组 */
+int tuplesort_set_bound(Tuplesortstate *state, long bound) {
+    // 参数检查
+    if (!state || bound < 0 || bound > INT_MAX / 2) {
+        tuplesort_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (state->status != TSS_INITIAL || state->tuple_count > 0) {
+        tuplesort_error("必须在放入元组之前设置bound");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    state->bound = bound;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 有界堆操作
+ *
+ * heap_slots是按比较函数排列的大顶堆，堆顶是目前保留的元组中最大的一个，
+ * 新元组只有比堆顶小时才需要替换堆顶。
+ */
+static int tuplesort_heap_greater(Tuplesortstate *state, int i, int j) {
+    return state->compare(state->heap_slots[i].tuple, state->heap_slots[j].tuple,
+                          state->compare_arg) > 0;
+}
+
+static void tuplesort_heap_swap(Tuplesortstate *state, int i, int j) {
+    TupleSlot tmp = state->heap_slots[i];
+    state->heap_slots[i] = state->heap_slots[j];
+    state->heap_slots[j] = tmp;
+}
+
+static void tuplesort_heap_sift_up(Tuplesortstate *state, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!tuplesort_heap_greater(state, i, parent)) {
+            break;
+        }
+        tuplesort_heap_swap(state, i, parent);
+        i = parent;
+    }
+}
+
+static void tuplesort_heap_sift_down(Tuplesortstate *state, int i, int n) {
+    for (;;) {
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+    
+        if (left < n && tuplesort_heap_greater(state, left, largest)) {
+            largest = left;
+        }
+        if (right < n && tuplesort_heap_greater(state, right, largest)) {
+            largest = right;
+        }
+        if (largest == i) {
+            break;
+        }
+        tuplesort_heap_swap(state, i, largest);
+        i = largest;
+    }
+}
+
+/* 把scratch中的元组放入有界堆，不需要的元组直接丢弃 */
+static void tuplesort_heap_insert_scratch(Tuplesortstate *state) {
+    TupleSlot tmp;
+    
+    if (state->heap_count < state->bound) {
+        // 堆未满，交换存储后上浮
+        int i = state->heap_count++;
+        tmp = state->heap_slots[i];
+        state->heap_slots[i] = state->scratch;
+        state->scratch = tmp;
+        tuplesort_heap_sift_up(state, i);
+        return;
+    }
+    
+    if (state->compare(state->scratch.tuple, state->heap_slots[0].tuple,
+                       state->compare_arg) >= 0) {
+        return;
+    }
+    
+    // 替换堆顶：交换存储，旧堆顶的存储留给下一个元组复用
+    tmp = state->heap_slots[0];
+    state->heap_slots[0] = state->scratch;
+    state->scratch = tmp;
+    tuplesort_heap_sift_down(state, 0, state->heap_count);
+}
+
+/* 把内存中已收集的元组转成有界堆 */
+static int tuplesort_make_bounded_heap(Tuplesortstate *state) {
+    state->heap_slots = (TupleSlot*)malloc(sizeof(TupleSlot) * state->bound);
+    if (!state->heap_slots) {
+        tuplesort_error("无法为有界堆分配内存");
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    for (long i = 0; i < state->bound; i++) {
+        tuple_slot_init(&state->heap_slots[i]);
+    }
+    state->heap_count = 0;
+    
+    for (int i = 0; i < state->memstore->count; i++) {
+        int result = tuple_slot_copy(&state->scratch, state->memstore->tuples[i]);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        tuplesort_heap_insert_scratch(state);
+    }
+    
+    // 内存存储不再需要
+    tuplestore_free(state->memstore);
+    state->memstore = NULL;
+    state->status = TSS_BOUNDED;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 把顺串加入顺串数组 */
+static int tuplesort_append_run(Tuplesortstate *state, const TupleSortRun *run) {
+    if (state->nruns >= state->runs_capacity) {
+        int new_capacity = state->runs_capacity ? state->runs_capacity * 2 : 16;
+        TupleSortRun *runs = (TupleSortRun*)realloc(state->runs, sizeof(TupleSortRun) * new_capacity);
+        if (!runs) {
+            tuplesort_error("无法扩展顺串数组");
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        state->runs = runs;
+        state->runs_capacity = new_capacity;
+    }
+    state->runs[state->nruns++] = *run;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 对内存中的元组排序 */
+static void tuplesort_sort_memstore(Tuplesortstate *state) {
+    qsort_r(state->memstore->tuples, state->memstore->count, sizeof(Tuple*),
+            tuplesort_qsort_compare, state);
+}
+
+/*
+ * 顺串文件
+ *
+ * 所有顺串共用一个临时文件，只占一个文件描述符。同一时刻只有一个顺串在写，
+ * 新顺串（包括中间归并的输出）总是追加到文件末尾；已归并的顺串占用的空间
+ * 不回收。
+ */
+static int tuplesort_open_tape(Tuplesortstate *state) {
+    if (state->tape_fd >= 0) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    char template[sizeof(TUPLESORT_TEMP_FILE_TEMPLATE)];
+    strcpy(template, TUPLESORT_TEMP_FILE_TEMPLATE);
+    int fd = mkstemp(template);
+    if (fd == -1) {
+        tuplesort_io_error("无法创建临时文件");
+        return TUPLESTORE_ERROR_IO;
+    }
+    // 文件只通过描述符访问，立即删除，关闭时由系统回收
+    unlink(template);
+    
+    state->tape_fd = fd;
+    state->tape_size = 0;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 把bytes字节追加到顺串文件末尾 */
+static int tuplesort_tape_append(Tuplesortstate *state, const char *data, size_t bytes) {
+    size_t written = 0;
+    while (written < bytes) {
+        ssize_t n = pwrite(state->tape_fd, data + written, bytes - written,
+                           (off_t)(state->tape_size + (long)written));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            tuplesort_io_error("将顺串写入文件失败");
+            return TUPLESTORE_ERROR_IO;
+        }
+        written += (size_t)n;
+    }
+    state->tape_size += (long)bytes;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 把写缓冲区写入文件 */
+static int tuplesort_flush_write_buffer(Tuplesortstate *state) {
+    if (state->write_used == 0) {
+        return TUPLESTORE_SUCCESS;
+    }
+    int result = tuplesort_tape_append(state, state->write_buffer, state->write_used);
+    state->write_used = 0;
+    return result;
+}
+
+/* 开始写一个新顺串 */
+static int tuplesort_run_begin(Tuplesortstate *state) {
+    int result = tuplesort_open_tape(state);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    
+    state->write_buffer = (char*)malloc(TUPLESORT_WRITE_BUFFER_SIZE);
+    if (!state->write_buffer) {
+        tuplesort_error("无法为写缓冲区分配内存");
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    state->write_used = 0;
+    state->run_start = state->tape_size;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 向正在写的顺串追加一个元组 */
+static int tuplesort_run_write(Tuplesortstate *state, const Tuple *tuple) {
+    static const char padding[TUPLE_ALIGNOF] = {0};
+    size_t size = TUPLE_ALIGN(tuple->t_len);
+    size_t pad = size - tuple->t_len;
+    
+    if (state->write_used + size > TUPLESORT_WRITE_BUFFER_SIZE) {
+        int result = tuplesort_flush_write_buffer(state);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+    }
+    
+    // 比写缓冲区还大的元组直接写入文件
+    if (size > TUPLESORT_WRITE_BUFFER_SIZE) {
+        int result = tuplesort_tape_append(state, (const char*)tuple, tuple->t_len);
+        if (result == TUPLESTORE_SUCCESS) {
+            result = tuplesort_tape_append(state, padding, pad);
+        }
+        return result;
+    }
+    
+    memcpy(state->write_buffer + state->write_used, tuple, tuple->t_len);
+    memset(state->write_buffer + state->write_used + tuple->t_len, 0, pad);
+    state->write_used += size;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 结束正在写的顺串，刷新并释放写缓冲区，在run中返回顺串的位置 */
+static int tuplesort_run_end(Tuplesortstate *state, TupleSortRun *run) {
+    int result = tuplesort_flush_write_buffer(state);
+    free(state->write_buffer);
+    state->write_buffer = NULL;
+    
+    memset(run, 0, sizeof(*run));
+    run->start = state->run_start;
+    run->end = state->tape_size;
+    return result;
+}
+
+/*
+ * 提示内核异步预读顺串的下一个块
+ *
+ * 归并交替读取各个顺串，对文件来说是在多个位置之间跳跃，内核的顺序预读
+ * 不起作用；每次填充读缓冲区后预读这个顺串接下来的一个缓冲区，下次轮到它
+ * 填充时数据已经在页缓存中。
+ */
+static void tuplesort_run_prefetch(Tuplesortstate *state, TupleSortRun *run) {
+#ifdef POSIX_FADV_WILLNEED
+    long bytes = run->end - run->read_offset;
+    if (bytes > (long)run->buffer_bytes) {
+        bytes = (long)run->buffer_bytes;
+    }
+    if (bytes > 0) {
+        posix_fadvise(state->tape_fd, (off_t)run->read_offset, (off_t)bytes,
+                      POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)state;
+    (void)run;
+#endif
+}
+
+/*
+ * 从顺串中顺序读取下一个元组（借用读缓冲区，下一次读取这个顺串前有效）
+ *
+ * 缓冲区中剩下的不是一个完整元组时，把剩余字节移到缓冲区开头，再从文件
+ * 读满缓冲区；元组比缓冲区大时扩大缓冲区。顺串读完或出错时返回NULL，
+ * 出错时错误码记录在run->error中。
+ */
+static const Tuple* tuplesort_run_next(Tuplesortstate *state, TupleSortRun *run) {
+    for (;;) {
+        size_t avail = run->buffer_used - run->buffer_pos;
+        size_t need = TUPLE_HEADER_SIZE;
+        if (avail >= TUPLE_HEADER_SIZE) {
+            const Tuple *tuple = (const Tuple*)(run->buffer + run->buffer_pos);
+            need = TUPLE_ALIGN(tuple->t_len);
+            if (avail >= need) {
+                run->buffer_pos += need;
+                return tuple;
+            }
+        }
+        
+        if (run->read_offset >= run->end) {
+            if (avail > 0) {
+                tuplesort_error("顺串文件被截断");
+                run->error = TUPLESTORE_ERROR_IO;
+            }
+            return NULL;
+        }
+        
+        memmove(run->buffer, run->buffer + run->buffer_pos, avail);
+        run->buffer_pos = 0;
+        run->buffer_used = avail;
+        if (need > run->buffer_bytes) {
+            char *buffer = (char*)realloc(run->buffer, need);
+            if (!buffer) {
+                tuplesort_error("无法扩展读缓冲区");
+                run->error = TUPLESTORE_ERROR_MEMORY;
+                return NULL;
+            }
+            run->buffer = buffer;
+            run->buffer_bytes = need;
+        }
+        
+        size_t bytes = run->buffer_bytes - avail;
+        if ((long)bytes > run->end - run->read_offset) {
+            bytes = (size_t)(run->end - run->read_offset);
+        }
+        size_t done = 0;
+        while (done < bytes) {
+            ssize_t n = pread(state->tape_fd, run->buffer + avail + done, bytes - done,
+                              (off_t)(run->read_offset + (long)done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                tuplesort_io_error("从文件读取顺串失败");
+                run->error = TUPLESTORE_ERROR_IO;
+                return NULL;
+            }
+            done += (size_t)n;
+        }
+        run->read_offset += (long)bytes;
+        run->buffer_used += bytes;
+        tuplesort_run_prefetch(state, run);
+    }
+}
+
+/* 把内存中的元组排序后写成一个顺串，写完后释放内存存储，换一个新的继续收集 */
+static int tuplesort_write_run(Tuplesortstate *state) {
+    if (state->memstore->count == 0) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    tuplesort_sort_memstore(state);
+    
+    int result = tuplesort_run_begin(state);
+    for (int i = 0; result == TUPLESTORE_SUCCESS && i < state->memstore->count; i++) {
+        result = tuplesort_run_write(state, state->memstore->tuples[i]);
+    }
+    
+    TupleSortRun run;
+    if (state->write_buffer) {
+        int end_result = tuplesort_run_end(state, &run);
+        if (result == TUPLESTORE_SUCCESS) {
+            result = end_result;
+        }
+    }
+    if (result == TUPLESTORE_SUCCESS) {
+        result = tuplesort_append_run(state, &run);
+    }
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    state->runs_written++;
+    
+    tuplestore_free(state->memstore);
+    state->memstore = tuplesort_new_memstore(state);
+    if (!state->memstore) {
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 放入一个元组 */
+int tuplesort_puttuple(Tuplesortstate *state, int id, const char *data) {
+    // 参数检查
+    if (!state || !data) {
+        tuplesort_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int result;
+    switch (state->status) {
+        case TSS_BOUNDED:
+            // 在scratch中构造元组，只有进入堆时才保留
+            result = tuple_slot_store(&state->scratch, id, data);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+            tuplesort_heap_insert_scratch(state);
+            state->tuple_count++;
+            return TUPLESTORE_SUCCESS;
+    
+        case TSS_INITIAL:
+        case TSS_BUILDRUNS:
+            break;
+    
+        default:
+            tuplesort_error("排序已经完成，不能再放入元组");
+            return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 放入后会超过work_mem时，先把已收集的元组写成顺串
+    size_t tuple_size = TUPLE_ALIGN(TUPLE_HEADER_SIZE + strlen(data) + 1);
+    if (tuplesort_lack_memory(state, tuple_size)) {
+        result = tuplesort_write_run(state);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        state->status = TSS_BUILDRUNS;
+    }
+    
+    result = tuplestore_put(state->memstore, id, data);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    state->tuple_count++;
+    
+    // 单个元组就超过了work_mem，存储已经把它写入自己的文件，读回来单独作为一个顺串
+    if (state->memstore->using_file) {
+        result = tuplestore_rescan(state->memstore);
+        if (result == TUPLESTORE_SUCCESS) {
+            result = tuplesort_run_begin(state);
+        }
+        const Tuple *tuple;
+        while (result == TUPLESTORE_SUCCESS &&
+               (tuple = tuplestore_get_next_borrowed(state->memstore)) != NULL) {
+            result = tuplesort_run_write(state, tuple);
+        }
+        TupleSortRun run;
+        if (state->write_buffer) {
+            int end_result = tuplesort_run_end(state, &run);
+            if (result == TUPLESTORE_SUCCESS) {
+                result = end_result;
+            }
+        }
+        if (result == TUPLESTORE_SUCCESS) {
+            result = tuplesort_append_run(state, &run);
+        }
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        state->runs_written++;
+        state->status = TSS_BUILDRUNS;
+        tuplestore_free(state->memstore);
+        state->memstore = tuplesort_new_memstore(state);
+        if (!state->memstore) {
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    // 还没有写出顺串时，元组数超过bound的两倍就改用有界堆（与PostgreSQL相同）
+    if (state->status == TSS_INITIAL && state->bound > 0 &&
+        state->memstore->count > state->bound * 2) {
+        return tuplesort_make_bounded_heap(state);
+    }
+    
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 多路归并
+ *
+ * 每个顺串用tuplesort_run_next读取，当前元组直接指向顺串的读缓冲区，
+ * 只有返回过元组的那个顺串会在下一次调用时前进，所以返回的元组在下一次调用前有效。
+ */
+static int tuplesort_merger_less(Tuplesortstate *state, TupleMerger *merger, int i, int j) {
+    int a = merger->heap[i];
+    int b = merger->heap[j];
+    int result = state->compare(merger->current[a], merger->current[b], state->compare_arg);
+    // 相等时先输出编号小的顺串，保持顺串之间的先后顺序
+    return result < 0 || (result == 0 && a < b);
+}
+
+static void tuplesort_merger_sift_down(Tuplesortstate *state, TupleMerger *merger, int i) {
+    int n = merger->heap_count;
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+    
+        if (left < n && tuplesort_merger_less(state, merger, left, smallest)) {
+            smallest = left;
+        }
+        if (right < n && tuplesort_merger_less(state, merger, right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        int tmp = merger->heap[i];
+        merger->heap[i] = merger->heap[smallest];
+        merger->heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void tuplesort_merger_free(TupleMerger *merger) {
+    // 释放各顺串的读缓冲区
+    for (int i = 0; i < merger->nsources; i++) {
+        free(merger->sources[i].buffer);
+        merger->sources[i].buffer = NULL;
+        merger->sources[i].buffer_bytes = 0;
+    }
+    free(merger->current);
+    free(merger->heap);
+    merger->current = NULL;
+    merger->heap = NULL;
+    merger->sources = NULL;
+    merger->heap_count = 0;
+    merger->nsources = 0;
+    merger->last = -1;
+}
+
+/* 开始归并sources中的n个顺串，每个顺串分到work_mem / n的读缓冲区 */
+static int tuplesort_merger_begin(Tuplesortstate *state, TupleMerger *merger,
+                                  TupleSortRun *sources, int n) {
+    merger->current = (const Tuple**)malloc(sizeof(Tuple*) * n);
+    merger->heap = (int*)malloc(sizeof(int) * n);
+    if (!merger->current || !merger->heap) {
+        tuplesort_error("无法为归并状态分配内存");
+        tuplesort_merger_free(merger);
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    for (int i = 0; i < n; i++) {
+        sources[i].buffer = NULL;
+    }
+    merger->sources = sources;
+    merger->nsources = n;
+    merger->heap_count = 0;
+    merger->last = -1;
+    merger->error = TUPLESTORE_SUCCESS;
+    
+    size_t block_bytes = state->work_mem / n;
+    if (block_bytes < TUPLESORT_MERGE_BUFFER_SIZE) {
+        block_bytes = TUPLESORT_MERGE_BUFFER_SIZE;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        TupleSortRun *run = &sources[i];
+        run->buffer = (char*)malloc(block_bytes);
+        if (!run->buffer) {
+            tuplesort_error("无法为读缓冲区分配内存");
+            tuplesort_merger_free(merger);
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        run->buffer_bytes = block_bytes;
+        run->buffer_used = 0;
+        run->buffer_pos = 0;
+        run->read_offset = run->start;
+        run->error = TUPLESTORE_SUCCESS;
+    
+        merger->current[i] = tuplesort_run_next(state, run);
+        if (merger->current[i]) {
+            merger->heap[merger->heap_count++] = i;
+        } else if (run->error != TUPLESTORE_SUCCESS) {
+            int result = run->error;
+            tuplesort_merger_free(merger);
+            return result;
+        }
+    }
+    for (int i = merger->heap_count / 2 - 1; i >= 0; i--) {
+        tuplesort_merger_sift_down(state, merger, i);
+    }
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 取归并结果中的下一个元组，归并结束或出错时返回NULL
+ *
+ * 顺串读取出错时不能只把它移出堆，否则结果会少掉这个顺串剩余的元组；
+ * 错误码记录在merger->error中，之后一直返回NULL。
+ */
+static const Tuple* tuplesort_merger_next(Tuplesortstate *state, TupleMerger *merger) {
+    if (merger->error != TUPLESTORE_SUCCESS) {
+        return NULL;
+    }
+    
+    // 让上一次返回元组的顺串前进
+    if (merger->last >= 0) {
+        int run = merger->last;
+        merger->current[run] = tuplesort_run_next(state, &merger->sources[run]);
+        if (!merger->current[run]) {
+            if (merger->sources[run].error != TUPLESTORE_SUCCESS) {
+                merger->error = merger->sources[run].error;
+                return NULL;
+            }
+            merger->heap[0] = merger->heap[--merger->heap_count];
+        }
+        tuplesort_merger_sift_down(state, merger, 0);
+        merger->last = -1;
+    }
+    
+    if (merger->heap_count == 0) {
+        return NULL;
+    }
+    merger->last = merger->heap[0];
+    return merger->current[merger->last];
+}
+
+/* 把runs中前n个顺串归并成一个新顺串，放到顺串数组末尾 */
+static int tuplesort_merge_runs(Tuplesortstate *state, int n) {
+    TupleMerger merger = {0};
+    merger.last = -1;
+    
+    int result = tuplesort_merger_begin(state, &merger, state->runs, n);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    result = tuplesort_run_begin(state);
+    
+    const Tuple *tuple;
+    while (result == TUPLESTORE_SUCCESS &&
+           (tuple = tuplesort_merger_next(state, &merger)) != NULL) {
+        result = tuplesort_run_write(state, tuple);
+    }
+    if (result == TUPLESTORE_SUCCESS) {
+        result = merger.error;
+    }
+    tuplesort_merger_free(&merger);
+    
+    TupleSortRun output;
+    if (state->write_buffer) {
+        int end_result = tuplesort_run_end(state, &output);
+        if (result == TUPLESTORE_SUCCESS) {
+            result = end_result;
+        }
+    }
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    
+    // 去掉已归并的顺串，新顺串放在末尾，这样每一趟都先归并最早（最短）的顺串
+    memmove(state->runs, state->runs + n, sizeof(TupleSortRun) * (state->nruns - n));
+    state->nruns -= n;
+    return tuplesort_append_run(state, &output);
+}
+
+/* 输入结束，完成排序 */
+int tuplesort_performsort(Tuplesortstate *state) {
+    // 参数检查
+    if (!state) {
+        tuplesort_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int result;
+    switch (state->status) {
+        case TSS_INITIAL:
+            // 全部元组都在内存中
+            tuplesort_sort_memstore(state);
+            result = tuplestore_rescan(state->memstore);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+            state->status = TSS_SORTEDINMEM;
+            return TUPLESTORE_SUCCESS;
+    
+        case TSS_BOUNDED:
+            // 堆排序：反复把堆顶换到末尾，得到升序
+            for (int n = state->heap_count - 1; n > 0; n--) {
+                tuplesort_heap_swap(state, 0, n);
+                tuplesort_heap_sift_down(state, 0, n);
+            }
+            state->read_pos = 0;
+            state->status = TSS_SORTEDHEAP;
+            return TUPLESTORE_SUCCESS;
+    
+        case TSS_BUILDRUNS:
+            break;
+    
+        default:
+            tuplesort_error("排序已经完成");
+            return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 最后一个顺串
+    result = tuplesort_write_run(state);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    tuplestore_free(state->memstore);
+    state->memstore = NULL;
+    
+    // 顺串多于一趟能归并的数量时，先做中间归并。顺串按队列处理：归并队首的
+    // 顺串，结果放到队尾；队列中原有的顺串都归并过一次算作一趟
+    int pass_runs = 0;    // 本趟还没有归并的顺串数
+    while (state->nruns > state->merge_order) {
+        if (pass_runs <= 0) {
+            state->merge_passes++;
+            pass_runs = state->nruns;
+        }
+        int n = state->merge_order;
+        // 让最后一趟正好归并merge_order个顺串，减少中间趟写出的数据量
+        int excess = state->nruns - state->merge_order + 1;
+        if (excess < n) {
+            n = excess;
+        }
+        result = tuplesort_merge_runs(state, n);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        pass_runs -= n;
+    }
+    
+    // 最后一趟归并在读取时进行
+    result = tuplesort_merger_begin(state, &state->merger, state->runs, state->nruns);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    state->status = TSS_FINALMERGE;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 按顺序获取下一个元组 */
+const Tuple* tuplesort_gettuple(Tuplesortstate *state) {
+    // 参数检查
+    if (!state) {
+        tuplesort_error("无效的参数");
+        return NULL;
+    }
+    
+    // 有bound时最多返回bound个元组
+    if (state->bound > 0 && state->returned >= state->bound) {
+        return NULL;
+    }
+    
+    const Tuple *tuple;
+    switch (state->status) {
+        case TSS_SORTEDINMEM:
+            tuple = tuplestore_get_next_borrowed(state->memstore);
+            break;
+    
+        case TSS_SORTEDHEAP:
+            tuple = state->read_pos < state->heap_count ?
+                    state->heap_slots[state->read_pos++].tuple : NULL;
+            break;
+    
+        case TSS_FINALMERGE:
+            tuple = tuplesort_merger_next(state, &state->merger);
+            break;
+    
+        default:
+            tuplesort_error("需要先调用tuplesort_performsort");
+            return NULL;
+    }
+    
+    if (tuple) {
+        state->returned++;
+    }
+    return tuple;
+}
+
+/* 读取过程中的错误码 */
+int tuplesort_get_error(Tuplesortstate *state) {
+    if (!state) {
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (state->status == TSS_FINALMERGE) {
+        return state->merger.error;
+    }
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 释放排序状态 */
+int tuplesort_end(Tuplesortstate *state) {
+    if (!state) {
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int result = TUPLESTORE_SUCCESS;
+    
+    tuplesort_merger_free(&state->merger);
+    
+    free(state->runs);
+    free(state->write_buffer);
+    if (state->tape_fd >= 0 && close(state->tape_fd) != 0) {
+        result = TUPLESTORE_ERROR_CLEANUP;
+    }
+    
+    if (state->memstore && tuplestore_free(state->memstore) != TUPLESTORE_SUCCESS) {
+        result = TUPLESTORE_ERROR_CLEANUP;
+    }
+    
+    if (state->heap_slots) {
+        for (long i = 0; i < state->bound; i++) {
+            tuple_slot_release(&state->heap_slots[i]);
+        }
+        free(state->heap_slots);
+    }
+    tuple_slot_release(&state->scratch);
+    
+    free(state);
+    return result;
+}
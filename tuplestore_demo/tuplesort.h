@@ -0,0 +1,127 @@
+#ifndef TUPLESORT_H
+#define TUPLESORT_H
+
+#include "tuplestore.h"
+
+/**
+ * Tuplesort - 基于TupleStore的外部归并排序
+ * 内存中快速排序，超出work_mem时把有序顺串写入临时文件，最后做多路堆归并
+ */
+
+/* 元组比较函数，返回负数、0或正数 */
+typedef int (*TupleCompareFunc)(const Tuple *a, const Tuple *b, void *arg);
+
+/* 每个顺串在归并时至少使用的读缓冲区大小 */
+#define TUPLESORT_MERGE_BUFFER_SIZE (32 * 1024)
+
+/* 一趟归并最多同时读取的顺串数 */
+#define TUPLESORT_MAX_MERGE_ORDER 64
+
+/* 写顺串时使用的写缓冲区大小 */
+#define TUPLESORT_WRITE_BUFFER_SIZE (64 * 1024)
+
+/* 排序状态 */
+typedef enum {
+    TSS_INITIAL = 0,     /* 在内存中收集元组 */
+    TSS_BOUNDED,         /* 用有界堆保留最小的bound个元组 */
+    TSS_BUILDRUNS,       /* 已经向临时文件写出过顺串 */
+    TSS_SORTEDINMEM,     /* 内存中排序完成 */
+    TSS_SORTEDHEAP,      /* 有界堆排序完成 */
+    TSS_FINALMERGE       /* 读取时进行最后一趟归并 */
+} TupSortStatus;
+
+/*
+ * 顺串
+ *
+ * 所有顺串依次写入同一个临时文件，每个顺串是文件中一段连续的区间，元组按
+ * 内存中的格式存放（长度前缀，按TUPLE_ALIGN对齐）。顺串只会从头到尾顺序读取，
+ * 不需要偏移索引；读缓冲区只在归并期间分配。
+ */
+typedef struct {
+    long start;            /* 顺串在文件中的起始偏移 */
+    long end;              /* 顺串在文件中的结束偏移 */
+    long read_offset;      /* 下一次从文件读取的偏移 */
+    char *buffer;          /* 读缓冲区 */
+    size_t buffer_bytes;   /* 读缓冲区容量 */
+    size_t buffer_used;    /* 读缓冲区中的有效字节数 */
+    size_t buffer_pos;     /* 下一个元组在读缓冲区中的位置 */
+    int error;             /* 读取出错时的错误码，否则为TUPLESTORE_SUCCESS */
+} TupleSortRun;
+
+/* 多路归并状态 */
+typedef struct {
+    TupleSortRun *sources; /* 参与归并的顺串 */
+    const Tuple **current; /* 每个顺串的当前元组（借用顺串缓冲区） */
+    int *heap;             /* 按当前元组排序的小顶堆（顺串下标） */
+    int heap_count;        /* 堆中的顺串数量 */
+    int nsources;          /* 顺串数量 */
+    int last;              /* 上一次返回元组的顺串，-1表示无 */
+    int error;             /* 读取顺串出错时的错误码，出错后不再返回元组 */
+} TupleMerger;
+
+/* 排序状态 */
+typedef struct {
+    TupSortStatus status;      /* 当前状态 */
+    TupleCompareFunc compare;  /* 比较函数 */
+    void *compare_arg;         /* 比较函数的附加参数 */
+    size_t work_mem;           /* 可用内存（字节） */
+
+    /* 内存中的元组，复用TupleStore的内存块分配和内存统计 */
+    TupleStore *memstore;
+
+    /* 有界排序（ORDER BY ... LIMIT） */
+    long bound;                /* 只需要最小的bound个元组，0表示不限 */
+    TupleSlot *heap_slots;     /* 大顶堆，每个槽持有一个元组 */
+    int heap_count;            /* 堆中的元组数量 */
+    TupleSlot scratch;         /* 构造新元组用的槽 */
+
+    /* 外部排序 */
+    int tape_fd;               /* 存放所有顺串的临时文件，-1表示还没有创建 */
+    long tape_size;            /* 临时文件已写入的字节数 */
+    char *write_buffer;        /* 写缓冲区，只在写顺串期间存在 */
+    size_t write_used;         /* 写缓冲区中已使用的字节数 */
+    long run_start;            /* 正在写的顺串的起始偏移 */
+    TupleSortRun *runs;        /* 已写出的有序顺串 */
+    int nruns;                 /* 顺串数量 */
+    int runs_capacity;         /* 顺串数组容量 */
+    int merge_order;           /* 一趟归并最多读取的顺串数 */
+    TupleMerger merger;        /* 最后一趟归并 */
+
+    /* 读取 */
+    int read_pos;              /* 有界堆的读取位置 */
+    long returned;             /* 已经返回的元组数 */
+
+    /* 统计 */
+    long tuple_count;          /* 输入的元组总数 */
+    int runs_written;          /* 写出的初始顺串数 */
+    int merge_passes;          /* 最后一趟之前的归并趟数（一趟把当时所有的顺串各归并一次） */
+} Tuplesortstate;
+
+/* 创建排序状态，work_mem_kb为可用内存（KB） */
+Tuplesortstate* tuplesort_begin(int work_mem_kb, TupleCompareFunc compare, void *arg);
+
+/* 设置只需要最小的bound个元组，必须在放入元组之前调用 */
+int tuplesort_set_bound(Tuplesortstate *state, long bound);
+
+/* 放入一个元组 */
+int tuplesort_puttuple(Tuplesortstate *state, int id, const char *data);
+
+/* 输入结束，完成排序 */
+int tuplesort_performsort(Tuplesortstate *state);
+
+/* 按顺序获取下一个元组（借用，下一次调用前有效），结束或出错时返回NULL */
+const Tuple* tuplesort_gettuple(Tuplesortstate *state);
+
+/* 读取过程中的错误码，tuplesort_gettuple返回NULL后用它区分出错与读完 */
+int tuplesort_get_error(Tuplesortstate *state);
+
+/* 释放排序状态 */
+int tuplesort_end(Tuplesortstate *state);
+
+/* 按id比较 */
+int tuplesort_compare_id(const Tuple *a, const Tuple *b, void *arg);
+
+/* 按data比较，相同时按id比较 */
+int tuplesort_compare_data(const Tuple *a, const Tuple *b, void *arg);
+
+#endif /* TUPLESORT_H */
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "tuplesort.h"
+
+/* 放入count个伪随机id的元组 */
+static int put_random_tuples(Tuplesortstate *state, int count) {
+    unsigned int seed = 12345;
+    for (int i = 0; i < count; i++) {
+        char data[64];
+        seed = seed * 1103515245 + 12345;
+        int id = (int)((seed >> 8) % 1000000);
+        snprintf(data, sizeof(data), "排序元组 #%d", i);
+        int result = tuplesort_puttuple(state, id, data);
+        if (result != TUPLESTORE_SUCCESS) {
+            printf("放入元组失败，错误代码: %d\n", result);
+            return result;
+        }
+    }
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 读出全部结果并检查顺序，返回读出的元组数，顺序错误或读取出错时返回-1 */
+static long read_and_check(Tuplesortstate *state, int show) {
+    const Tuple *tuple;
+    long count = 0;
+    int prev = 0;
+    while ((tuple = tuplesort_gettuple(state)) != NULL) {
+        if (count > 0 && tuple->id < prev) {
+            printf("顺序错误: %d 出现在 %d 之后\n", tuple->id, prev);
+            return -1;
+        }
+        if (count < show) {
+            printf("  id=%d, data=%s\n", tuple->id, tuple->data);
+        }
+        prev = tuple->id;
+        count++;
+    }
+    int result = tuplesort_get_error(state);
+    if (result != TUPLESTORE_SUCCESS) {
+        printf("读取排序结果失败，错误代码: %d\n", result);
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * 示例主函数 - 展示如何使用Tuplesort
+ */
+int main() {
+    printf("===== Tuplesort 示例 =====\n\n");
+    
+    // 内存排序：数据量小于work_mem
+    Tuplesortstate *state = tuplesort_begin(1024, tuplesort_compare_id, NULL);
+    if (!state) {
+        printf("创建排序状态失败\n");
+        return 1;
+    }
+    if (put_random_tuples(state, 1000) != TUPLESTORE_SUCCESS ||
+        tuplesort_performsort(state) != TUPLESTORE_SUCCESS) {
+        tuplesort_end(state);
+        return 1;
+    }
+    printf("内存排序（前5个）:\n");
+    long count = read_and_check(state, 5);
+    printf("读取 %ld 个元组, 顺串数: %d\n\n", count, state->runs_written);
+    tuplesort_end(state);
+    if (count < 0) {
+        return 1;
+    }
+    
+    // 外部排序：work_mem只有256KB，需要写出顺串并多趟归并
+    state = tuplesort_begin(256, tuplesort_compare_id, NULL);
+    if (!state) {
+        printf("创建排序状态失败\n");
+        return 1;
+    }
+    if (put_random_tuples(state, 200000) != TUPLESTORE_SUCCESS ||
+        tuplesort_performsort(state) != TUPLESTORE_SUCCESS) {
+        tuplesort_end(state);
+        return 1;
+    }
+    printf("外部排序（前5个）:\n");
+    count = read_and_check(state, 5);
+    printf("读取 %ld 个元组, 初始顺串数: %d, 归并路数: %d, 中间归并趟数: %d\n\n",
+           count, state->runs_written, state->merge_order, state->merge_passes);
+    tuplesort_end(state);
+    if (count < 0) {
+        return 1;
+    }
+    
+    // 有界排序（ORDER BY id LIMIT 10）：只保留最小的10个元组
+    state = tuplesort_begin(64, tuplesort_compare_id, NULL);
+    if (!state) {
+        printf("创建排序状态失败\n");
+        return 1;
+    }
+    tuplesort_set_bound(state, 10);
+    if (put_random_tuples(state, 200000) != TUPLESTORE_SUCCESS ||
+        tuplesort_performsort(state) != TUPLESTORE_SUCCESS) {
+        tuplesort_end(state);
+        return 1;
+    }
+    printf("有界排序 LIMIT 10:\n");
+    count = read_and_check(state, 10);
+    printf("读取 %ld 个元组, 是否使用有界堆: %s, 顺串数: %d\n",
+           count, state->status == TSS_SORTEDHEAP ? "是" : "否", state->runs_written);
+    tuplesort_end(state);
+    if (count < 0) {
+        return 1;
+    }
+    
+    printf("\n===== 示例完成 =====\n");
+    return 0;
+}
@@ -0,0 +1,2327 @@
+#define _GNU_SOURCE  /* fallocate */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+#include "tuplestore.h"
+
+/* 常量定义 */
+#define TUPLESTORE_INITIAL_CAPACITY 100   /* 初始元组数组容量 */
+#define TUPLESTORE_BUFFER_MEMORY_RATIO 0.5 /* 缓冲区内存占比 */
+#define TUPLESTORE_WRITE_BLOCK_INIT (16 * 1024)   /* 写缓冲区的初始刷新大小 */
+#define TUPLESTORE_WRITE_BLOCK_MAX (1024 * 1024)  /* 写缓冲区刷新大小的上限 */
+#define TUPLESTORE_INITIAL_BUFFER_BYTES 1024 /* 缓冲区初始字节数，不足时自动扩大 */
+#define TUPLESTORE_INITIAL_OFFSETS 256     /* 文件偏移索引初始容量 */
+#define TUPLESTORE_CHUNK_INIT_SIZE 1024    /* 第一个元组内存块的大小 */
+#define TUPLESTORE_CHUNK_MAX_SIZE (64 * 1024) /* 元组内存块的最大大小 */
+#define TUPLESTORE_INITIAL_READPTRS 8      /* 读指针数组初始容量 */
+#define TUPLESTORE_TRIM_PAGE_SIZE 4096     /* 裁剪临时文件时释放空间的粒度 */
+#define TUPLESTORE_DEFAULT_READ_BLOCK (64 * 1024) /* 默认每次从文件读取的字节数 */
+#define TUPLESTORE_COMPRESS_BLOCK_SIZE (32 * 1024) /* 压缩模式下每个块的原始字节数 */
+#define TUPLESTORE_INITIAL_BLOCKS 64       /* 块目录初始容量 */
+#define TUPLESTORE_PROJECTED_SIZE TUPLE_ALIGN(TUPLE_HEADER_SIZE + 1) /* 只投影id列时每个元组占用的字节数 */
+#define TUPLESTORE_TEMP_FILE_TEMPLATE "/tmp/tuplestore_XXXXXX"
+
+/* 错误处理函数 */
+static void tuplestore_error(const char *message) {
+    fprintf(stderr, "TupleStore错误: %s (%s)\n", message, strerror(errno));
+}
+
+/* 单调时钟的当前时间（纳秒），clock_gettime通过vDSO读取，不进入内核 */
+static uint64_t tuplestore_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* current_memory增加后更新峰值 */
+static void tuplestore_note_memory(TupleStore *store) {
+    if (store->current_memory > store->stats.peak_memory) {
+        store->stats.peak_memory = store->current_memory;
+    }
+}
+
+/* 元组分配函数，按对齐后的大小分配 */
+static Tuple* tuplestore_alloc_tuple(size_t t_len) {
+    Tuple *tuple = (Tuple*)malloc(TUPLE_ALIGN(t_len));
+    if (!tuple) {
+        tuplestore_error("无法为元组分配内存");
+    }
+    return tuple;
+}
+
+/* 在dest处构造元组，对齐填充字节清零以免写入未初始化的数据 */
+static void tuplestore_fill_tuple(Tuple *dest, uint32_t t_len, int id, const char *data) {
+    size_t stored = TUPLE_ALIGN(t_len);
+    
+    dest->t_len = t_len;
+    dest->id = id;
+    memcpy(dest->data, data, t_len - TUPLE_HEADER_SIZE);
+    memset((char*)dest + t_len, 0, stored - t_len);
+}
+
+/* 计算以data为数据的元组长度，数据过长时返回错误码 */
+static int tuplestore_tuple_len(const char *data, uint32_t *t_len) {
+    size_t data_len = strlen(data) + 1;
+    if (data_len > UINT32_MAX - TUPLE_HEADER_SIZE - TUPLE_ALIGNOF) {
+        tuplestore_error("元组数据过长");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    *t_len = (uint32_t)(TUPLE_HEADER_SIZE + data_len);
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 返回元组的副本，调用者负责释放 */
+static Tuple* tuplestore_copy_tuple(const Tuple *src) {
+    Tuple *result = tuplestore_alloc_tuple(src->t_len);
+    if (result) {
+        memcpy(result, src, src->t_len);
+    }
+    return result;
+}
+
+/*
+ * 计算分配size字节的元组需要新增的内存
+ *
+ * 当前块放得下时返回0；否则返回新块的大小。新块大小按几何级数增长，
+ * 但不超过剩余的内存预算（至少能放下这个元组），这样内存统计是精确的。
+ */
+static size_t tuplestore_chunk_request(TupleStore *store, size_t size) {
+    TupleChunk *tail = store->chunk_tail;
+    if (tail && tail->size - tail->used >= size) {
+        return 0;
+    }
+    
+    size_t min_size = sizeof(TupleChunk) + size;
+    size_t chunk_size = store->next_chunk_size;
+    long remaining = (long)store->max_memory_kb * 1024 - store->current_memory;
+    
+    if (remaining > 0 && chunk_size > (size_t)remaining) {
+        chunk_size = (size_t)remaining;
+    }
+    if (chunk_size < min_size) {
+        chunk_size = min_size;
+    }
+    return chunk_size;
+}
+
+/* 从内存块中分配元组，chunk_size为tuplestore_chunk_request的结果 */
+static Tuple* tuplestore_chunk_alloc(TupleStore *store, size_t size, size_t chunk_size) {
+    if (chunk_size > 0) {
+        TupleChunk *chunk = (TupleChunk*)malloc(chunk_size);
+        if (!chunk) {
+            tuplestore_error("无法为元组内存块分配内存");
+            return NULL;
+        }
+        chunk->next = NULL;
+        chunk->size = chunk_size;
+        chunk->used = sizeof(TupleChunk);
+        
+        if (store->chunk_tail) {
+            store->chunk_tail->next = chunk;
+        } else {
+            store->chunk_head = chunk;
+        }
+        store->chunk_tail = chunk;
+        store->current_memory += (int)chunk_size;
+        tuplestore_note_memory(store);
+        
+        if (store->next_chunk_size < TUPLESTORE_CHUNK_MAX_SIZE) {
+            store->next_chunk_size *= 2;
+        }
+    }
+    
+    TupleChunk *tail = store->chunk_tail;
+    Tuple *tuple = (Tuple*)((char*)tail + tail->used);
+    tail->used += size;
+    return tuple;
+}
+
+/* 释放第一个元组内存块之前的所有块，first之后（含）的块保留 */
+static void tuplestore_chunk_release_before(TupleStore *store, const Tuple *first) {
+    TupleChunk *chunk = store->chunk_head;
+    while (chunk && chunk != store->chunk_tail &&
+           !((const char*)first >= (char*)chunk &&
+             (const char*)first < (char*)chunk + chunk->used)) {
+        TupleChunk *next = chunk->next;
+        store->current_memory -= (int)chunk->size;
+        free(chunk);
+        chunk = next;
+    }
+    store->chunk_head = chunk;
+}
+
+/* 整体释放所有元组内存块 */
+static void tuplestore_chunk_release(TupleStore *store) {
+    TupleChunk *chunk = store->chunk_head;
+    while (chunk) {
+        TupleChunk *next = chunk->next;
+        store->current_memory -= (int)chunk->size;
+        free(chunk);
+        chunk = next;
+    }
+    store->chunk_head = NULL;
+    store->chunk_tail = NULL;
+    store->next_chunk_size = TUPLESTORE_CHUNK_INIT_SIZE;
+}
+
+/* 解除临时文件的映射 */
+static void tuplestore_unmap_file(TupleStore *store) {
+    if (store->map_base) {
+        munmap(store->map_base, store->map_size);
+        store->map_base = NULL;
+        store->map_size = 0;
+        store->map_valid = 0;
+    }
+}
+
+/*
+ * 确保映射覆盖临时文件中已写入的全部数据
+ *
+ * 映射长度按两倍增长。溢出的块用pwrite写入，写完即在页缓存中，MAP_SHARED
+ * 映射与页缓存一致，所以文件在映射范围内增长时只需更新map_valid。超出映射
+ * 范围时重新映射，之前借出的指针随之失效，这与零拷贝接口"在下一次调用前
+ * 有效"的约定一致。
+ */
+static int tuplestore_map_file(TupleStore *store) {
+    size_t file_size = (size_t)store->file_size;
+    if (store->map_base && store->map_valid >= file_size) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    if (store->map_base && store->map_size >= file_size) {
+        store->map_valid = file_size;
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    size_t map_size = store->map_size * 2;
+    if (map_size < file_size) {
+        map_size = file_size;
+    }
+    
+    tuplestore_unmap_file(store);
+    void *base = mmap(NULL, map_size, PROT_READ, MAP_SHARED,
+                      fileno(store->temp_file), 0);
+    if (base == MAP_FAILED) {
+        tuplestore_error("无法映射临时文件");
+        return TUPLESTORE_ERROR_IO;
+    }
+    store->map_base = (char*)base;
+    store->map_size = map_size;
+    store->map_valid = file_size;
+    
+    if (store->readahead) {
+        madvise(store->map_base, store->map_size, MADV_SEQUENTIAL);
+    }
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 内置的LZ4块格式压缩
+ *
+ * 没有liblz4时使用。输出是标准的LZ4块格式：每个序列由一个标记字节
+ * （高4位字面量长度，低4位匹配长度-4）、字面量、2字节偏移和扩展长度组成，
+ * 并遵守LZ4对块尾部的限制（最后5字节必须是字面量），因此两种实现写出的块
+ * 可以互相解压。这里只用单一哈希表做贪心匹配，追求速度而不是压缩率。
+ */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MF_LIMIT 12
+#define LZ_MAX_OFFSET 65535
+
+/* LZ4块格式的最坏情况输出大小 */
+#define LZ_COMPRESS_BOUND(len) ((len) + (len) / 255 + 16)
+
+#ifndef USE_LZ4
+
+static uint32_t lz_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint8_t* lz_write_length(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* 压缩src，返回压缩后的字节数；输出放不进dst（不可压缩）时返回0 */
+static size_t lz_compress(const char *src, size_t len, char *dst, size_t capacity) {
+    const uint8_t *base = (const uint8_t*)src;
+    const uint8_t *ip = base;
+    const uint8_t *anchor = base;
+    const uint8_t *end = base + len;
+    const uint8_t *match_limit = end - LZ_LAST_LITERALS;
+    uint8_t *op = (uint8_t*)dst;
+    uint8_t *op_end = op + capacity;
+    uint32_t table[1 << LZ_HASH_BITS];
+    
+    memset(table, 0, sizeof(table));  // 0表示空槽，位置存储为pos+1
+    
+    if (len > LZ_MF_LIMIT) {
+        const uint8_t *mf_limit = end - LZ_MF_LIMIT;
+        while (ip < mf_limit) {
+            uint32_t seq = lz_read32(ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+            uint32_t candidate = table[h];
+            table[h] = (uint32_t)(ip - base) + 1;
+            
+            const uint8_t *ref = base + candidate - 1;
+            if (candidate == 0 || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+            
+            // 向后扩展匹配，匹配不能进入最后LZ_LAST_LITERALS字节
+            const uint8_t *mp = ip + LZ_MIN_MATCH;
+            const uint8_t *rp = ref + LZ_MIN_MATCH;
+            while (mp < match_limit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+            
+            size_t literals = (size_t)(ip - anchor);
+            size_t match_len = (size_t)(mp - ip) - LZ_MIN_MATCH;
+            if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals + 2 + match_len / 255 + 1) {
+                return 0;
+            }
+            
+            uint8_t *token = op++;
+            *token = (uint8_t)((literals >= 15 ? 15 : literals) << 4);
+            if (literals >= 15) {
+                op = lz_write_length(op, literals - 15);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+            
+            uint16_t offset = (uint16_t)(ip - ref);
+            *op++ = (uint8_t)(offset & 0xff);
+            *op++ = (uint8_t)(offset >> 8);
+            
+            *token |= (uint8_t)(match_len >= 15 ? 15 : match_len);
+            if (match_len >= 15) {
+                op = lz_write_length(op, match_len - 15);
+            }
+            
+            ip = anchor = mp;
+        }
+    }
+    
+    // 最后一个序列只有字面量
+    size_t literals = (size_t)(end - anchor);
+    if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals) {
+        return 0;
+    }
+    *op++ = (uint8_t)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15) {
+        op = lz_write_length(op, literals - 15);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+    
+    return (size_t)(op - (uint8_t*)dst);
+}
+
+/* 读取扩展长度，越界时返回-1 */
+static int lz_read_length(const uint8_t **ip, const uint8_t *end, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= end) {
+            return -1;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+/* 解压到dst，要求恰好得到raw_len字节；数据损坏时返回-1 */
+static int lz_decompress(const char *src, size_t len, char *dst, size_t raw_len) {
+    const uint8_t *ip = (const uint8_t*)src;
+    const uint8_t *end = ip + len;
+    uint8_t *op = (uint8_t*)dst;
+    uint8_t *op_end = op + raw_len;
+    
+    while (ip < end) {
+        uint8_t token = *ip++;
+        
+        size_t literals = token >> 4;
+        if (literals == 15 && lz_read_length(&ip, end, &literals) != 0) {
+            return -1;
+        }
+        if (literals > (size_t)(end - ip) || literals > (size_t)(op_end - op)) {
+            return -1;
+        }
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        
+        if (ip >= end) {
+            break;  // 最后一个序列
+        }
+        
+        if (end - ip < 2) {
+            return -1;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - (uint8_t*)dst)) {
+            return -1;
+        }
+        
+        size_t match_len = token & 15;
+        if (match_len == 15 && lz_read_length(&ip, end, &match_len) != 0) {
+            return -1;
+        }
+        match_len += LZ_MIN_MATCH;
+        if (match_len > (size_t)(op_end - op)) {
+            return -1;
+        }
+        
+        // 匹配可能与输出重叠，逐字节复制
+        const uint8_t *match = op - offset;
+        for (size_t i = 0; i < match_len; i++) {
+            op[i] = match[i];
+        }
+        op += match_len;
+    }
+    
+    return op == op_end ? 0 : -1;
+}
+
+#endif   /* !USE_LZ4 */
+
+/* 压缩一个块，返回压缩后的字节数，不可压缩时返回0 */
+static size_t tuplestore_compress_block(const char *src, size_t len, char *dst, size_t capacity) {
+#ifdef USE_LZ4
+    int n = LZ4_compress_default(src, dst, (int)len, (int)capacity);
+    return n > 0 ? (size_t)n : 0;
+#else
+    return lz_compress(src, len, dst, capacity);
+#endif
+}
+
+/* 解压一个块，成功返回0 */
+static int tuplestore_decompress_block(const char *src, size_t len, char *dst, size_t raw_len) {
+#ifdef USE_LZ4
+    int n = LZ4_decompress_safe(src, dst, (int)len, (int)raw_len);
+    return n == (int)raw_len ? 0 : -1;
+#else
+    return lz_decompress(src, len, dst, raw_len);
+#endif
+}
+
+/* 确保压缩临时空间至少能容纳bytes字节 */
+static int tuplestore_reserve_compress_buffer(TupleStore *store, size_t bytes) {
+    if (bytes <= store->compress_buffer_bytes) {
+        return TUPLESTORE_SUCCESS;
+    }
+    char *new_buffer = (char*)realloc(store->compress_buffer, bytes);
+    if (!new_buffer) {
+        tuplestore_error("无法为压缩缓冲区分配内存");
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    store->compress_buffer = new_buffer;
+    store->compress_buffer_bytes = bytes;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 在块目录末尾追加一项 */
+static TupleStoreBlock* tuplestore_append_block(TupleStore *store) {
+    if (store->block_count >= store->block_capacity) {
+        int new_capacity = store->block_capacity > 0 ? store->block_capacity * 2
+                                                     : TUPLESTORE_INITIAL_BLOCKS;
+        TupleStoreBlock *new_blocks = (TupleStoreBlock*)realloc(store->blocks,
+                                                               sizeof(TupleStoreBlock) * new_capacity);
+        if (!new_blocks) {
+            tuplestore_error("无法扩大块目录");
+            return NULL;
+        }
+        store->blocks = new_blocks;
+        store->block_capacity = new_capacity;
+    }
+    return &store->blocks[store->block_count++];
+}
+
+/* 查找包含第pos个元组的块 */
+static TupleStoreBlock* tuplestore_find_block(TupleStore *store, int pos) {
+    int lo = 0;
+    int hi = store->block_count - 1;
+    
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (store->blocks[mid].first_tuple <= pos) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return &store->blocks[lo];
+}
+
+/* 临时文件是否按块组织（压缩模式或PAX格式），这时按块目录读取整块 */
+static int tuplestore_uses_blocks(TupleStore *store) {
+    return store->compression != TUPLESTORE_COMPRESS_NONE || store->layout == TUPLESTORE_LAYOUT_PAX;
+}
+
+/* 确保缓冲区至少能容纳bytes字节 */
+static int tuplestore_reserve_buffer(TupleStore *store, size_t bytes) {
+    if (bytes <= store->buffer_bytes) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    size_t new_bytes = store->buffer_bytes * 2;
+    if (new_bytes < bytes) {
+        new_bytes = bytes;
+    }
+    
+    char *new_buffer = (char*)realloc(store->buffer, new_bytes);
+    if (!new_buffer) {
+        tuplestore_error("无法扩大缓冲区");
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    store->buffer = new_buffer;
+    store->buffer_bytes = new_bytes;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 确保文件偏移索引至少能容纳count个元组 */
+static int tuplestore_reserve_offsets(TupleStore *store, int count) {
+    if (count <= store->offsets_capacity) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    int new_capacity = store->offsets_capacity > 0 ? store->offsets_capacity * 2
+                                                   : TUPLESTORE_INITIAL_OFFSETS;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+    
+    long *new_offsets = (long*)realloc(store->file_offsets, sizeof(long) * new_capacity);
+    if (!new_offsets) {
+        tuplestore_error("无法扩大文件偏移索引");
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    store->file_offsets = new_offsets;
+    store->offsets_capacity = new_capacity;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 第pos个元组在文件中的起始偏移，pos等于file_count时返回文件末尾 */
+static long tuplestore_file_offset(TupleStore *store, int pos) {
+    return pos < store->file_count ? store->file_offsets[pos] : store->file_size;
+}
+
+/* 从start开始，一个读取块内能完整放下的元组数量（至少一个） */
+static int tuplestore_block_tuples(TupleStore *store, int start) {
+    long limit = store->file_offsets[start] + (long)store->read_block_bytes;
+    int lo = start + 1;
+    int hi = store->file_count;
+    
+    // 偏移索引是递增的，二分查找最后一个结束位置不超过limit的元组
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (tuplestore_file_offset(store, mid) <= limit) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo - start;
+}
+
+/* 以pos结尾、一个读取块内能完整放下的第一个元组的位置（向后读取时使用） */
+static int tuplestore_block_start(TupleStore *store, int pos) {
+    long limit = tuplestore_file_offset(store, pos + 1) - (long)store->read_block_bytes;
+    int lo = 0;
+    int hi = pos;
+    
+    // 二分查找第一个起始偏移不小于limit的元组
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (store->file_offsets[mid] >= limit) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/* 提示内核异步预读从offset开始的下一个块，读取方取到它时已在页缓存中 */
+static void tuplestore_prefetch(TupleStore *store, long offset) {
+#ifdef POSIX_FADV_WILLNEED
+    if (store->readahead && offset < store->file_physical_size) {
+        posix_fadvise(fileno(store->temp_file), offset,
+                      (off_t)store->read_block_bytes, POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)store;
+    (void)offset;
+#endif
+}
+
+/* 创建元组存储 */
+TupleStore* tuplestore_create(int max_memory_kb) {
+    if (max_memory_kb <= 0) {
+        tuplestore_error("无效的内存限制参数");
+        return NULL;
+    }
+    
+    TupleStore *store = (TupleStore*)malloc(sizeof(TupleStore));
+    if (!store) {
+        tuplestore_error("无法为TupleStore分配内存");
+        return NULL;
+    }
+    
+    // 初始化基本属性
+    store->capacity = TUPLESTORE_INITIAL_CAPACITY;
+    store->count = 0;
+    store->read_pos = 0;
+    store->max_memory_kb = max_memory_kb;
+    store->current_memory = sizeof(TupleStore);
+    store->chunk_head = NULL;
+    store->chunk_tail = NULL;
+    store->next_chunk_size = TUPLESTORE_CHUNK_INIT_SIZE;
+    store->temp_file = NULL;
+    store->using_file = 0;
+    store->file_count = 0;
+    store->filename = NULL;
+    store->file_offsets = NULL;
+    store->offsets_capacity = 0;
+    store->file_size = 0;
+    store->file_physical_size = 0;
+    store->compression = TUPLESTORE_COMPRESS_NONE;
+    store->blocks = NULL;
+    store->block_count = 0;
+    store->block_capacity = 0;
+    store->compress_buffer = NULL;
+    store->compress_buffer_bytes = 0;
+    store->layout = TUPLESTORE_LAYOUT_ROW;
+    store->projection = TUPLESTORE_COLUMN_ALL;
+    
+    // 分配元组数组
+    store->tuples = (Tuple**)malloc(sizeof(Tuple*) * store->capacity);
+    if (!store->tuples) {
+        tuplestore_error("无法为元组数组分配内存");
+        free(store);
+        return NULL;
+    }
+    store->current_memory += sizeof(Tuple*) * store->capacity;
+    memset(&store->stats, 0, sizeof(TupleStoreStats));
+    tuplestore_note_memory(store);
+    store->read_end = 0;
+    
+    // 文件缓冲区不计入内存使用
+    store->write_block_bytes = TUPLESTORE_WRITE_BLOCK_INIT;
+    store->write_block_max = TUPLESTORE_WRITE_BLOCK_MAX;
+    store->buffer_bytes = TUPLESTORE_INITIAL_BUFFER_BYTES;
+    store->buffer_used = 0;
+    store->read_block_bytes = TUPLESTORE_DEFAULT_READ_BLOCK;
+    store->readahead = 1;
+    store->use_mmap = 0;
+    store->map_base = NULL;
+    store->map_size = 0;
+    store->map_valid = 0;
+    
+    // 分配连续内存块用于存储元组数据
+    store->buffer = (char*)malloc(store->buffer_bytes);
+    if (!store->buffer) {
+        tuplestore_error("无法为缓冲区分配内存");
+        free(store->tuples);
+        free(store);
+        return NULL;
+    }
+    
+    // 初始化缓冲区
+    store->buffer_offset = 0;
+    store->buffer_start = 0;
+    store->buffer_count = 0;
+    store->buffer_write_mode = BUFFER_MODE_READ;  // 初始化为读取模式
+    
+    // 创建读指针0，默认支持rescan；它的状态就是上面的活动状态
+    store->readptrs = (TSReadPointer*)malloc(sizeof(TSReadPointer) * TUPLESTORE_INITIAL_READPTRS);
+    if (!store->readptrs) {
+        tuplestore_error("无法为读指针分配内存");
+        free(store->buffer);
+        free(store->tuples);
+        free(store);
+        return NULL;
+    }
+    memset(&store->readptrs[0], 0, sizeof(TSReadPointer));
+    store->readptrs[0].eflags = TUPLESTORE_EFLAG_REWIND;
+    store->readptrs[0].mark_pos = -1;
+    store->readptrcount = 1;
+    store->readptrsize = TUPLESTORE_INITIAL_READPTRS;
+    store->activeptr = 0;
+    
+    return store;
+}
+
+/* 写缓冲区是否达到刷新阈值：压缩模式按块的字节数，否则按元组数 */
+static int tuplestore_write_buffer_full(TupleStore *store) {
+    if (store->compression != TUPLESTORE_COMPRESS_NONE) {
+        return store->buffer_used >= TUPLESTORE_COMPRESS_BLOCK_SIZE;
+    }
+    return store->buffer_used >= store->write_block_bytes;
+}
+
+/*
+ * 在写缓冲区中为一个占用stored字节的元组预留空间
+ *
+ * 必要时切换到写入模式、刷新已满的缓冲区并扩大缓冲区，同时在偏移索引中
+ * 记录元组的位置。返回元组应写入的位置，失败时返回NULL并设置*error。
+ */
+static Tuple* tuplestore_write_slot(TupleStore *store, size_t stored, int *error) {
+    // 如果缓冲区不在写入模式，切换为写入模式
+    if (store->buffer_write_mode != BUFFER_MODE_WRITE) {
+        // 当使用连续内存块时，只需要重置计数器
+        store->buffer_count = 0;
+        store->buffer_used = 0;
+        store->buffer_write_mode = BUFFER_MODE_WRITE;
+    }
+    
+    // 放不下这个元组时先刷新，使每次写入不超过一个写入块
+    if (store->buffer_count > 0 && store->buffer_used + stored > store->write_block_bytes &&
+        store->compression == TUPLESTORE_COMPRESS_NONE) {
+        *error = tuplestore_flush_buffer(store);
+        if (*error != TUPLESTORE_SUCCESS) {
+            return NULL;
+        }
+        store->buffer_write_mode = BUFFER_MODE_WRITE;
+    }
+    
+    // 确保缓冲区和偏移索引有足够空间
+    *error = tuplestore_reserve_buffer(store, store->buffer_used + stored);
+    if (*error == TUPLESTORE_SUCCESS) {
+        *error = tuplestore_reserve_offsets(store, store->file_count + store->buffer_count + 1);
+    }
+    if (*error != TUPLESTORE_SUCCESS) {
+        return NULL;
+    }
+    
+    // 记录元组在（未压缩）数据流中的偏移
+    Tuple *dest = (Tuple*)(store->buffer + store->buffer_used);
+    store->file_offsets[store->file_count + store->buffer_count] =
+        store->file_size + (long)store->buffer_used;
+    store->buffer_used += stored;
+    store->buffer_count++;
+    return dest;
+}
+
+/*
+ * 把写缓冲区中按行存放的元组转换为PAX格式，放入compress_buffer
+ *
+ * 块内依次是n个id、n个t_len和各元组的数据（含结尾'\0'，不再对齐），
+ * 只需要id列的扫描只读块开头的n个id。返回转换后的字节数，不超过原始字节数。
+ */
+static size_t tuplestore_pax_encode(TupleStore *store) {
+    int n = store->buffer_count;
+    int *ids = (int*)store->compress_buffer;
+    uint32_t *lens = (uint32_t*)(ids + n);
+    char *data = (char*)(lens + n);
+    
+    size_t offset = 0;
+    for (int i = 0; i < n; i++) {
+        const Tuple *tuple = (const Tuple*)(store->buffer + offset);
+        size_t data_len = tuple->t_len - TUPLE_HEADER_SIZE;
+        ids[i] = tuple->id;
+        lens[i] = tuple->t_len;
+        memcpy(data, tuple->data, data_len);
+        data += data_len;
+        offset += TUPLE_ALIGN(tuple->t_len);
+    }
+    return (size_t)(data - store->compress_buffer);
+}
+
+/* 将缓冲区中的元组刷新到文件（写入模式） */
+int tuplestore_flush_buffer(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 如果没有需要刷新的内容，直接返回成功
+    if (!store->using_file || !store->temp_file || 
+        store->buffer_write_mode != BUFFER_MODE_WRITE || 
+        store->buffer_count == 0) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    // 注意：使用连续内存块后，不需要复制元组
+    const char *write_data = store->buffer;
+    size_t write_bytes = store->buffer_used;
+    
+    // 压缩模式和PAX格式：整个缓冲区作为一个块压缩或按列重排，并记录到块目录
+    if (tuplestore_uses_blocks(store)) {
+        size_t needed = store->compression != TUPLESTORE_COMPRESS_NONE ?
+                        LZ_COMPRESS_BOUND(store->buffer_used) : store->buffer_used;
+        int result = tuplestore_reserve_compress_buffer(store, needed);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        
+        TupleStoreBlock *block = tuplestore_append_block(store);
+        if (!block) {
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        
+        if (store->layout == TUPLESTORE_LAYOUT_PAX) {
+            write_data = store->compress_buffer;
+            write_bytes = tuplestore_pax_encode(store);
+        } else {
+            size_t compressed = tuplestore_compress_block(store->buffer, store->buffer_used,
+                                                          store->compress_buffer,
+                                                          store->buffer_used - 1);
+            if (compressed > 0) {
+                write_data = store->compress_buffer;
+                write_bytes = compressed;
+            }
+        }
+        
+        block->first_tuple = store->file_count;
+        block->ntuples = store->buffer_count;
+        block->logical_offset = store->file_size;
+        block->file_offset = store->file_physical_size;
+        block->raw_len = (uint32_t)store->buffer_used;
+        block->stored_len = (uint32_t)write_bytes;
+    }
+    
+    // 直接从连续内存块（或压缩后的数据）中批量写入文件末尾。
+    // 使用pwrite绕过stdio：整个块一次系统调用写入页缓存，不需要再fflush，
+    // 其他文件描述符（mmap、pread）立即可以看到数据；文件只会追加，
+    // 读取路径fseek后通过stdio读到的数据不会过期
+    int fd = fileno(store->temp_file);
+    size_t bytes_written = 0;
+    uint64_t start_ns = tuplestore_now_ns();
+    while (bytes_written < write_bytes) {
+        ssize_t n = pwrite(fd, write_data + bytes_written, write_bytes - bytes_written,
+                           (off_t)(store->file_physical_size + (long)bytes_written));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            tuplestore_error("将元组写入文件失败");
+            return TUPLESTORE_ERROR_IO;
+        }
+        bytes_written += (size_t)n;
+    }
+    store->stats.write_ns += tuplestore_now_ns() - start_ns;
+    store->stats.write_calls++;
+    store->stats.bytes_written += (long)write_bytes;
+    
+    // 写满一个块说明还在持续溢出，下一次使用两倍大的块（直到上限），
+    // 少量溢出只需要小缓冲区，持续溢出时每次写入接近顺序带宽
+    if (store->buffer_used * 2 >= store->write_block_bytes &&
+        store->write_block_bytes < store->write_block_max) {
+        store->write_block_bytes *= 2;
+        if (store->write_block_bytes > store->write_block_max) {
+            store->write_block_bytes = store->write_block_max;
+        }
+    }
+    
+    // 更新文件中的元组数量（偏移索引在元组进入缓冲区时已经记录）
+    store->file_count += store->buffer_count;
+    store->file_size += (long)store->buffer_used;
+    store->file_physical_size += (long)write_bytes;
+    store->buffer_count = 0;
+    store->buffer_used = 0;
+    
+    // 重置缓冲区模式为读取模式
+    store->buffer_write_mode = BUFFER_MODE_READ;
+    
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 将内存中的元组转储到文件 */
+int tuplestore_dump_to_file(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 已经在使用文件且没有元组要转储，直接返回成功
+    // （空的内存存储仍会切换到文件模式，供需要直接写文件的调用者使用）
+    if (store->count == 0 && store->using_file) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    // 如果文件尚未创建，创建一个临时文件
+    if (!store->temp_file) {
+        char template[sizeof(TUPLESTORE_TEMP_FILE_TEMPLATE)];
+        strcpy(template, TUPLESTORE_TEMP_FILE_TEMPLATE);
+        
+        int fd = mkstemp(template);
+        if (fd == -1) {
+            tuplestore_error("无法创建临时文件");
+            return TUPLESTORE_ERROR_IO;
+        }
+        
+        store->temp_file = fdopen(fd, "w+b");
+        if (!store->temp_file) {
+            tuplestore_error("无法打开临时文件");
+            close(fd);
+            unlink(template);
+            return TUPLESTORE_ERROR_IO;
+        }
+        
+        store->filename = strdup(template);
+        if (!store->filename) {
+            tuplestore_error("无法复制文件名");
+            fclose(store->temp_file);
+            store->temp_file = NULL;
+            unlink(template);
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+    }
+    
+    // 从现在起元组存放在文件中
+    uint64_t start_ns = tuplestore_now_ns();
+    if (!store->using_file) {
+        store->stats.spill_count++;
+        store->stats.spilled_tuples += store->count;
+    }
+    store->using_file = 1;
+    
+    // 内存中的元组经过写缓冲区写入文件，与后续元组使用同样的块格式
+    int result = TUPLESTORE_SUCCESS;
+    for (int i = 0; i < store->count; i++) {
+        if (store->tuples[i]) {
+            size_t stored = TUPLE_ALIGN(store->tuples[i]->t_len);
+            
+            Tuple *dest = tuplestore_write_slot(store, stored, &result);
+            if (!dest) {
+                break;
+            }
+            memcpy(dest, store->tuples[i], stored);
+            store->tuples[i] = NULL;
+            
+            if (tuplestore_write_buffer_full(store)) {
+                result = tuplestore_flush_buffer(store);
+                if (result != TUPLESTORE_SUCCESS) {
+                    break;
+                }
+            }
+        }
+    }
+    if (result == TUPLESTORE_SUCCESS) {
+        result = tuplestore_flush_buffer(store);
+    }
+    
+    // 整体释放元组内存块
+    tuplestore_chunk_release(store);
+    
+    // 更新状态
+    store->count = 0;
+    store->stats.spill_ns += tuplestore_now_ns() - start_ns;
+    
+    // 注意：不重置文件指针，保持在文件末尾以便后续写入
+    // 读取操作会在tuplestore_rescan或tuplestore_fill_buffer中重置文件指针
+    
+    return result;
+}
+
+/* 添加元组到存储中 */
+int tuplestore_put(TupleStore *store, int id, const char *data) {
+    // 参数检查
+    if (!store || !data) {
+        tuplestore_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 计算变长元组的长度
+    uint32_t t_len;
+    int len_result = tuplestore_tuple_len(data, &t_len);
+    if (len_result != TUPLESTORE_SUCCESS) {
+        return len_result;
+    }
+    
+    int tuple_size = (int)TUPLE_ALIGN(t_len);
+    
+    // 如果不使用文件，检查并处理数组容量
+    if (!store->using_file && store->count >= store->capacity) {
+        // 计算扩容后的新容量
+        int new_capacity = store->capacity * 2;
+        int memory_increase = sizeof(Tuple*) * (new_capacity - store->capacity);
+        
+        // 如果扩容会超过内存限制
+        if (store->current_memory + memory_increase > store->max_memory_kb * 1024) {
+            // 计算在不超过内存限制的情况下可以扩容的最大容量
+            int max_allowed_increase = (store->max_memory_kb * 1024) - store->current_memory;
+            int max_new_capacity = store->capacity + (max_allowed_increase / sizeof(Tuple*));
+            
+            // 如果无法进一步扩容，则转储到文件
+            if (max_new_capacity <= store->capacity) {
+                int result = tuplestore_dump_to_file(store);
+                if (result != TUPLESTORE_SUCCESS) {
+                    return result;
+                }
+            } else {
+                // 只扩容到允许的最大容量
+                new_capacity = max_new_capacity;
+                
+                // 重新分配内存
+                Tuple **new_tuples = (Tuple**)realloc(store->tuples, sizeof(Tuple*) * new_capacity);
+                if (!new_tuples) {
+                    tuplestore_error("无法为元组数组重新分配内存");
+                    return TUPLESTORE_ERROR_MEMORY;
+                }
+                
+                // 更新内存使用和容量
+                store->current_memory += sizeof(Tuple*) * (new_capacity - store->capacity);
+                tuplestore_note_memory(store);
+                store->capacity = new_capacity;
+                store->tuples = new_tuples;
+            }
+        } else {
+            // 正常扩容
+
+            Tuple **new_tuples = (Tuple**)realloc(store->tuples, sizeof(Tuple*) * new_capacity);
+            if (!new_tuples) {
+                tuplestore_error("无法为元组数组重新分配内存");
+                return TUPLESTORE_ERROR_MEMORY;
+            }
+            
+            // 更新内存使用和容量
+            store->current_memory += sizeof(Tuple*) * (new_capacity - store->capacity);
+            tuplestore_note_memory(store);
+            store->capacity = new_capacity;
+            store->tuples = new_tuples;
+        }
+    }
+    
+    // 检查内存是否足够：只有当前内存块放不下时才需要新的内存
+    size_t chunk_size = 0;
+    if (!store->using_file) {
+        chunk_size = tuplestore_chunk_request(store, tuple_size);
+        if (store->current_memory + (long)chunk_size > (long)store->max_memory_kb * 1024) {
+            // 内存不足，转储到文件
+            int result = tuplestore_dump_to_file(store);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+        }
+    }
+    
+    // 如果已经在使用文件存储，添加到缓冲区
+    if (store->using_file) {
+        // 直接在缓冲区的连续内存块中构造元组
+        int result;
+        Tuple *dest = tuplestore_write_slot(store, tuple_size, &result);
+        if (!dest) {
+            return result;
+        }
+        tuplestore_fill_tuple(dest, t_len, id, data);
+        
+        // 如果缓冲区达到刷新阈值，则刷新到文件
+        if (tuplestore_write_buffer_full(store)) {
+            result = tuplestore_flush_buffer(store);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+        }
+    } else {
+        // 从内存块中分配新元组并添加到内存数组
+        Tuple *tuple = tuplestore_chunk_alloc(store, tuple_size, chunk_size);
+        if (!tuple) {
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        tuplestore_fill_tuple(tuple, t_len, id, data);
+        store->tuples[store->count++] = tuple;
+    }
+    
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 批量添加元组
+ *
+ * 结果与按顺序对每个元组调用tuplestore_put相同，但指针数组扩容、内存限制检查
+ * 和缓冲区模式切换按批进行：内存中的存储一次把指针数组扩大到能放下整批元组，
+ * 当前内存块放得下的元组不再检查内存限制；溢出后整批元组连续写入写缓冲区，
+ * 偏移索引一次预留。需要溢出或数组无法一次扩大时，对应的元组交给tuplestore_put。
+ * 出错时返回错误码，出错元组之前的元组已经加入存储。
+ */
+int tuplestore_put_batch(TupleStore *store, const int *ids, const char *const *data, int n) {
+    // 参数检查
+    if (!store || n < 0 || (n > 0 && (!ids || !data))) {
+        tuplestore_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 内存中的存储：指针数组一次扩大到能放下整批元组（不超过内存限制时）
+    if (!store->using_file && store->count + n > store->capacity) {
+        int new_capacity = store->capacity * 2;
+        if (new_capacity < store->count + n) {
+            new_capacity = store->count + n;
+        }
+        long memory_increase = (long)sizeof(Tuple*) * (new_capacity - store->capacity);
+        if (store->current_memory + memory_increase <= (long)store->max_memory_kb * 1024) {
+            Tuple **new_tuples = (Tuple**)realloc(store->tuples, sizeof(Tuple*) * new_capacity);
+            if (!new_tuples) {
+                tuplestore_error("无法为元组数组重新分配内存");
+                return TUPLESTORE_ERROR_MEMORY;
+            }
+            store->current_memory += (int)memory_increase;
+            tuplestore_note_memory(store);
+            store->capacity = new_capacity;
+            store->tuples = new_tuples;
+        }
+    }
+    
+    int i = 0;
+    while (i < n && !store->using_file) {
+        if (!data[i]) {
+            tuplestore_error("无效的参数");
+            return TUPLESTORE_ERROR_INVALID_PARAM;
+        }
+        uint32_t t_len;
+        int result = tuplestore_tuple_len(data[i], &t_len);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        size_t tuple_size = TUPLE_ALIGN(t_len);
+        
+        // 数组已满或新内存块超出限制时按tuplestore_put的规则扩容或溢出
+        size_t chunk_size = tuplestore_chunk_request(store, tuple_size);
+        if (store->count >= store->capacity ||
+            (chunk_size > 0 &&
+             store->current_memory + (long)chunk_size > (long)store->max_memory_kb * 1024)) {
+            result = tuplestore_put(store, ids[i], data[i]);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+            i++;
+            continue;
+        }
+        
+        Tuple *tuple = tuplestore_chunk_alloc(store, tuple_size, chunk_size);
+        if (!tuple) {
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        tuplestore_fill_tuple(tuple, t_len, ids[i], data[i]);
+        store->tuples[store->count++] = tuple;
+        i++;
+    }
+    if (i >= n) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    // 已经在使用文件：一次为剩下的元组预留偏移索引，元组直接构造在写缓冲区中
+    int result = tuplestore_reserve_offsets(store, store->file_count + store->buffer_count + (n - i));
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    for (; i < n; i++) {
+        if (!data[i]) {
+            tuplestore_error("无效的参数");
+            return TUPLESTORE_ERROR_INVALID_PARAM;
+        }
+        uint32_t t_len;
+        result = tuplestore_tuple_len(data[i], &t_len);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        
+        Tuple *dest = tuplestore_write_slot(store, TUPLE_ALIGN(t_len), &result);
+        if (!dest) {
+            return result;
+        }
+        tuplestore_fill_tuple(dest, t_len, ids[i], data[i]);
+        
+        if (tuplestore_write_buffer_full(store)) {
+            result = tuplestore_flush_buffer(store);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+        }
+    }
+    
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 从临时文件的offset处读取bytes字节到dest，并计入读取统计
+ *
+ * 读取不从上一次读取结束处开始时计为一次定位。
+ */
+static int tuplestore_read_file(TupleStore *store, long offset, char *dest, size_t bytes) {
+    uint64_t start_ns = tuplestore_now_ns();
+    
+    if (fseek(store->temp_file, offset, SEEK_SET) != 0) {
+        tuplestore_error("无法定位到读取位置");
+        return TUPLESTORE_ERROR_IO;
+    }
+    if (fread(dest, 1, bytes, store->temp_file) != bytes) {
+        // 读取错误或文件被截断
+        tuplestore_error("从文件读取元组失败");
+        return TUPLESTORE_ERROR_IO;
+    }
+    
+    store->stats.read_ns += tuplestore_now_ns() - start_ns;
+    store->stats.buffer_refills++;
+    store->stats.bytes_read += (long)bytes;
+    if (offset != store->read_end) {
+        store->stats.seeks++;
+    }
+    store->read_end = offset + (long)bytes;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 压缩模式下填充缓冲区：读入包含第pos个元组的整个块并解压
+ *
+ * 缓冲区随后覆盖该块中的全部元组，buffer_offset是块的逻辑偏移。
+ */
+static int tuplestore_fill_buffer_compressed(TupleStore *store, int pos) {
+    TupleStoreBlock *block = tuplestore_find_block(store, pos);
+    
+    // 重置缓冲区计数
+    store->buffer_count = 0;
+    
+    int result = tuplestore_reserve_buffer(store, block->raw_len);
+    if (result == TUPLESTORE_SUCCESS && block->stored_len != block->raw_len) {
+        result = tuplestore_reserve_compress_buffer(store, block->stored_len);
+    }
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    
+    // 未压缩的块直接读入缓冲区，压缩的块先读入临时空间再解压
+    char *target = block->stored_len == block->raw_len ? store->buffer : store->compress_buffer;
+    result = tuplestore_read_file(store, block->file_offset, target, block->stored_len);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    if (target != store->buffer &&
+        tuplestore_decompress_block(store->compress_buffer, block->stored_len,
+                                    store->buffer, block->raw_len) != 0) {
+        tuplestore_error("解压块失败");
+        return TUPLESTORE_ERROR_INTERNAL;
+    }
+    
+    // 调用者消费当前块的同时，让内核准备下一个块
+    tuplestore_prefetch(store, block->file_offset + (long)block->stored_len);
+    
+    store->buffer_offset = block->logical_offset;
+    store->buffer_start = block->first_tuple;
+    store->buffer_count = block->ntuples;
+    return store->buffer_count;
+}
+
+/*
+ * PAX格式下填充缓冲区：读入包含第pos个元组的块，重建为按行存放的元组
+ *
+ * 投影包含data列时读入整个块，重建后的元组与写入时的格式相同，仍然通过
+ * 偏移索引定位；只投影id列时只读入块开头的id列，每个元组重建为data为空串、
+ * 占用TUPLESTORE_PROJECTED_SIZE字节的元组。
+ */
+static int tuplestore_fill_buffer_pax(TupleStore *store, int pos) {
+    TupleStoreBlock *block = tuplestore_find_block(store, pos);
+    int n = block->ntuples;
+    int want_data = (store->projection & TUPLESTORE_COLUMN_DATA) != 0;
+    size_t read_bytes = want_data ? block->stored_len : sizeof(int) * (size_t)n;
+    size_t rebuilt = want_data ? block->raw_len : TUPLESTORE_PROJECTED_SIZE * (size_t)n;
+    
+    // 重置缓冲区计数
+    store->buffer_count = 0;
+    
+    int result = tuplestore_reserve_buffer(store, rebuilt);
+    if (result == TUPLESTORE_SUCCESS) {
+        result = tuplestore_reserve_compress_buffer(store, read_bytes);
+    }
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    
+    result = tuplestore_read_file(store, block->file_offset, store->compress_buffer, read_bytes);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    
+    const int *ids = (const int*)store->compress_buffer;
+    const uint32_t *lens = (const uint32_t*)(ids + n);
+    const char *data = (const char*)(lens + n);
+    size_t offset = 0;
+    for (int i = 0; i < n; i++) {
+        Tuple *tuple = (Tuple*)(store->buffer + offset);
+        tuple->id = ids[i];
+        if (want_data) {
+            size_t data_len = lens[i] - TUPLE_HEADER_SIZE;
+            tuple->t_len = lens[i];
+            memcpy(tuple->data, data, data_len);
+            data += data_len;
+            offset += TUPLE_ALIGN(lens[i]);
+        } else {
+            tuple->t_len = (uint32_t)(TUPLE_HEADER_SIZE + 1);
+            tuple->data[0] = '\0';
+            offset += TUPLESTORE_PROJECTED_SIZE;
+        }
+    }
+    
+    // 调用者消费当前块的同时，让内核准备下一个块
+    tuplestore_prefetch(store, block->file_offset + (long)block->stored_len);
+    
+    store->buffer_offset = block->logical_offset;
+    store->buffer_start = block->first_tuple;
+    store->buffer_count = n;
+    return store->buffer_count;
+}
+
+/*
+ * 从文件中读取从第start个元组开始的一个块到缓冲区
+ *
+ * 返回缓冲区中的元组数量，0表示start已超出文件范围，负值为错误码。
+ * 压缩模式和PAX格式下读入的是包含start的整个块。
+ */
+static int tuplestore_fill_buffer_at(TupleStore *store, int start) {
+    // 如果缓冲区处于写入模式，先刷新到文件
+    if (store->buffer_write_mode == BUFFER_MODE_WRITE) {
+        if (store->buffer_count > 0) {
+            int result = tuplestore_flush_buffer(store);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+            // 刷新后已经切换到读取模式
+        } else {
+            // 如果缓冲区处于写入模式但没有数据，直接切换到读取模式
+            store->buffer_write_mode = BUFFER_MODE_READ;
+        }
+    }
+    
+    // 检查读取位置是否有效
+    if (start >= store->file_count) {
+        // 已超出文件范围，没有数据可读
+        return 0;
+    }
+    
+    // 压缩模式按块读取和解压
+    if (store->compression != TUPLESTORE_COMPRESS_NONE) {
+        return tuplestore_fill_buffer_compressed(store, start);
+    }
+    if (store->layout == TUPLESTORE_LAYOUT_PAX) {
+        return tuplestore_fill_buffer_pax(store, start);
+    }
+    
+    // 计算要读取的起始位置
+    store->buffer_start = start;
+    
+    // 重置缓冲区计数
+    // 注意：使用连续内存块后，不需要释放单个元组
+    store->buffer_count = 0;
+    
+    // 计算要读取的元组数量：按字节大小的读取块放得下的完整元组
+    int to_read = tuplestore_block_tuples(store, store->buffer_start);
+    
+    // 通过偏移索引计算这批元组在文件中的字节范围
+    long offset = store->file_offsets[store->buffer_start];
+    store->buffer_offset = offset;
+    size_t bytes = (size_t)(tuplestore_file_offset(store, store->buffer_start + to_read) - offset);
+    int result = tuplestore_reserve_buffer(store, bytes);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    
+    // 直接将数据读取到连续内存块中
+    result = tuplestore_read_file(store, offset, store->buffer, bytes);
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    
+    // 调用者消费当前块的同时，让内核准备下一个块
+    tuplestore_prefetch(store, offset + (long)bytes);
+    
+    // 更新缓冲区计数
+    // 内存使用量已经在创建时计算，这里不需要再次计算
+    store->buffer_count = to_read;
+    
+    return store->buffer_count;
+}
+
+/* 从文件中读取数据到缓冲区 */
+int tuplestore_fill_buffer(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 检查是否可以从文件读取
+    if (!store->using_file || !store->temp_file) {
+        tuplestore_error("没有可用的文件进行读取");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    return tuplestore_fill_buffer_at(store, store->read_pos);
+}
+
+/* 存储中的元组总数，包括写缓冲区中还没有写入文件的元组 */
+static int tuplestore_total_tuples(TupleStore *store) {
+    if (!store->using_file) {
+        return store->count;
+    }
+    if (store->buffer_write_mode == BUFFER_MODE_WRITE) {
+        return store->file_count + store->buffer_count;
+    }
+    return store->file_count;
+}
+
+/* 当前读指针是否可以向后移动：需要rescan或向后读取的读指针，元组不会被裁剪 */
+static int tuplestore_can_backward(TupleStore *store) {
+    return (store->readptrs[store->activeptr].eflags &
+            (TUPLESTORE_EFLAG_REWIND | TUPLESTORE_EFLAG_BACKWARD)) != 0;
+}
+
+/*
+ * 已经在内存块、映射或缓冲区中的第pos个元组
+ *
+ * 调用者保证元组已经就绪：内存中的存储pos小于count，内存映射模式映射已经
+ * 覆盖pos，否则pos在当前读缓冲区中。只投影id列的PAX缓冲区中元组是定长的，
+ * 其余情况通过偏移索引定位变长元组。
+ */
+static Tuple* tuplestore_resident_tuple(TupleStore *store, int pos) {
+    if (!store->using_file) {
+        return store->tuples[pos];
+    }
+    if (store->use_mmap) {
+        return (Tuple*)(store->map_base + store->file_offsets[pos]);
+    }
+    if (store->layout == TUPLESTORE_LAYOUT_PAX && !(store->projection & TUPLESTORE_COLUMN_DATA)) {
+        return (Tuple*)(store->buffer + (size_t)(pos - store->buffer_start) * TUPLESTORE_PROJECTED_SIZE);
+    }
+    return (Tuple*)(store->buffer + (store->file_offsets[pos] - store->buffer_offset));
+}
+
+/*
+ * 定位第pos个元组，不复制元组，也不移动读取位置
+ *
+ * 成功时*tuple指向缓冲区、映射或内存块中的元组，返回1；pos超出范围时返回0；
+ * 出错时返回负的错误码。元组已经在当前缓冲区中时直接使用缓冲区，
+ * 否则读入一个新块：向前读取时块从pos开始，向后读取时块以pos结尾，
+ * 这样连续向后读取同样每个块只读一次。
+ */
+static int tuplestore_locate(TupleStore *store, int pos, int backward, Tuple **tuple) {
+    *tuple = NULL;
+    
+    if (!store->using_file) {
+        // 从内存读取
+        if (pos >= store->count) {
+            return 0;  // 已读取完所有元组
+        }
+        *tuple = tuplestore_resident_tuple(store, pos);
+        return *tuple ? 1 : TUPLESTORE_ERROR_INTERNAL;
+    }
+    
+    // 从文件读取
+    if (pos >= store->file_count) {
+        if (store->buffer_write_mode != BUFFER_MODE_WRITE || store->buffer_count == 0) {
+            return 0;  // 已读取完所有元组
+        }
+        // 写缓冲区中还有未写入文件的元组，刷新后继续读取
+        int result = tuplestore_flush_buffer(store);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        if (pos >= store->file_count) {
+            return 0;
+        }
+    }
+    
+    if (store->use_mmap) {
+        // 内存映射模式：直接返回映射中的元组，不经过缓冲区复制
+        int result = tuplestore_map_file(store);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        *tuple = tuplestore_resident_tuple(store, pos);
+    } else {
+        // 检查元组是否在缓冲区中
+        int buffer_index = pos - store->buffer_start;
+        
+        // 如果元组不在缓冲区中，需要重新填充缓冲区
+        if (buffer_index < 0 || buffer_index >= store->buffer_count ||
+            store->buffer_write_mode == BUFFER_MODE_WRITE) {
+            // 按块组织的文件总是读入包含pos的整个块，不需要调整起点
+            int start = pos;
+            if (backward && !tuplestore_uses_blocks(store)) {
+                start = tuplestore_block_start(store, pos);
+            }
+            int result = tuplestore_fill_buffer_at(store, start);
+            if (result <= 0) {  // 返回值小于等于0表示错误或没有数据
+                // 填充缓冲区失败或没有数据
+                return result;
+            }
+        }
+        
+        // 从缓冲区中获取元组
+        *tuple = tuplestore_resident_tuple(store, pos);
+    }
+    
+    return *tuple ? 1 : TUPLESTORE_ERROR_INTERNAL;
+}
+
+/*
+ * 定位下一个元组并移动读取位置，不复制元组
+ *
+ * 成功时*tuple指向缓冲区或内存块中的元组，返回1；没有更多元组时返回0；
+ * 出错时返回负的错误码。
+ */
+static int tuplestore_fetch_next(TupleStore *store, Tuple **tuple) {
+    int result = tuplestore_locate(store, store->read_pos, 0, tuple);
+    if (result > 0) {
+        // 移动读取位置
+        store->read_pos++;
+    }
+    return result;
+}
+
+/*
+ * 定位上一个元组并向后移动读取位置
+ *
+ * 读取位置位于两个元组之间：tuplestore_get_next返回位置之后的元组，
+ * 这里返回位置之前的元组，因此向前读一个元组后立即向后读会得到同一个元组。
+ */
+static int tuplestore_fetch_prev(TupleStore *store, Tuple **tuple) {
+    *tuple = NULL;
+    
+    if (!tuplestore_can_backward(store)) {
+        tuplestore_error("当前读指针不支持向后读取");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (store->read_pos <= 0) {
+        return 0;  // 已经在第一个元组之前
+    }
+    
+    int result = tuplestore_locate(store, store->read_pos - 1, 1, tuple);
+    if (result > 0) {
+        store->read_pos--;
+    }
+    return result;
+}
+
+/* 从存储中获取下一个元组 */
+Tuple* tuplestore_get_next(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return NULL;
+    }
+    
+    Tuple *src;
+    if (tuplestore_fetch_next(store, &src) <= 0) {
+        return NULL;
+    }
+    
+    // 创建返回元组的副本，保持一致的接口行为
+    // 这样无论是从文件还是内存读取，调用者都需要释放返回的元组
+    Tuple *result = tuplestore_copy_tuple(src);
+    if (!result) {
+        tuplestore_error("无法为结果元组分配内存");
+        return NULL;
+    }
+    
+    return result;
+}
+
+/*
+ * 以零拷贝方式获取下一个元组
+ *
+ * 返回的指针直接指向文件缓冲区或内存块中的元组，调用者不能释放或修改它。
+ * 指针只在对该存储的下一次调用（读取、写入、重置或释放）之前有效。
+ */
+const Tuple* tuplestore_get_next_borrowed(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return NULL;
+    }
+    
+    Tuple *tuple;
+    if (tuplestore_fetch_next(store, &tuple) <= 0) {
+        return NULL;
+    }
+    return tuple;
+}
+
+/*
+ * 以零拷贝方式获取上一个元组
+ *
+ * 需要当前读指针带有TUPLESTORE_EFLAG_BACKWARD或TUPLESTORE_EFLAG_REWIND。
+ * 返回的指针与tuplestore_get_next_borrowed有相同的有效期。
+ */
+const Tuple* tuplestore_get_prev_borrowed(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return NULL;
+    }
+    
+    Tuple *tuple;
+    if (tuplestore_fetch_prev(store, &tuple) <= 0) {
+        return NULL;
+    }
+    return tuple;
+}
+
+/*
+ * 批量获取元组（零拷贝）
+ *
+ * 最多把max个元组的指针放入tuples并移动读取位置，返回取到的元组数，0表示
+ * 没有更多元组，负值为错误码。一批元组都来自同一个缓冲区（或内存块、映射），
+ * 只需要一次填充缓冲区，在对该存储的下一次调用之前都有效；因此在缓冲区末尾
+ * 取到的元组可能少于max个，这不表示扫描结束。
+ */
+int tuplestore_get_batch(TupleStore *store, const Tuple **tuples, int max) {
+    // 参数检查
+    if (!store || !tuples || max <= 0) {
+        tuplestore_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 第一个元组按普通方式定位，必要时填充缓冲区
+    Tuple *first;
+    int result = tuplestore_locate(store, store->read_pos, 0, &first);
+    if (result <= 0) {
+        return result;
+    }
+    
+    // 之后不再需要I/O就能取到的元组数
+    int pos = store->read_pos;
+    int available;
+    if (!store->using_file) {
+        available = store->count - pos;
+    } else if (store->use_mmap) {
+        available = store->file_count - pos;
+    } else {
+        available = store->buffer_start + store->buffer_count - pos;
+    }
+    int n = available < max ? available : max;
+    
+    tuples[0] = first;
+    for (int i = 1; i < n; i++) {
+        tuples[i] = tuplestore_resident_tuple(store, pos + i);
+    }
+    store->read_pos += n;
+    return n;
+}
+
+/*
+ * 把读取位置移动n个元组（n为负时向后移动），不读取元组
+ *
+ * 偏移索引可以直接定位任意元组，所以跳过的元组不需要读入；之后的读取
+ * 如果落在当前缓冲区内就直接使用缓冲区。目标超出范围时停在开头或末尾
+ * 并返回0，否则返回1。
+ */
+int tuplestore_advance(TupleStore *store, int n) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (n < 0 && !tuplestore_can_backward(store)) {
+        tuplestore_error("当前读指针不支持向后读取");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    long target = (long)store->read_pos + n;
+    int total = tuplestore_total_tuples(store);
+    if (target < 0) {
+        store->read_pos = 0;
+        return 0;
+    }
+    if (target > total) {
+        store->read_pos = total;
+        return 0;
+    }
+    store->read_pos = (int)target;
+    return 1;
+}
+
+/*
+ * 记住当前读指针的读取位置（参照PostgreSQL早期的tuplestore_markpos）
+ *
+ * 标记之后的元组不会被tuplestore_trim丢弃，直到标记被移动或清除。
+ */
+int tuplestore_markpos(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    store->readptrs[store->activeptr].mark_pos = store->read_pos;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 回到tuplestore_markpos记住的位置
+ *
+ * 只修改读取位置，目标元组仍在当前缓冲区中时不需要重新读文件。
+ */
+int tuplestore_restorepos(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int mark_pos = store->readptrs[store->activeptr].mark_pos;
+    if (mark_pos < 0) {
+        tuplestore_error("当前读指针没有标记位置");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->read_pos = mark_pos;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 初始化元组槽 */
+void tuple_slot_init(TupleSlot *slot) {
+    slot->tuple = NULL;
+    slot->storage = NULL;
+    slot->storage_size = 0;
+}
+
+/* 释放元组槽自己持有的存储 */
+void tuple_slot_release(TupleSlot *slot) {
+    free(slot->storage);
+    tuple_slot_init(slot);
+}
+
+/* 确保元组槽自己的存储至少有stored字节，只在需要变大时重新分配 */
+static int tuple_slot_reserve(TupleSlot *slot, size_t stored) {
+    if (stored > slot->storage_size) {
+        Tuple *storage = (Tuple*)realloc(slot->storage, stored);
+        if (!storage) {
+            tuplestore_error("无法为元组槽分配内存");
+            slot->tuple = NULL;
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        slot->storage = storage;
+        slot->storage_size = stored;
+    }
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 将元组复制到槽自己的存储中 */
+int tuple_slot_copy(TupleSlot *slot, const Tuple *tuple) {
+    // 参数检查
+    if (!slot || !tuple) {
+        tuplestore_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int result = tuple_slot_reserve(slot, TUPLE_ALIGN(tuple->t_len));
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    memcpy(slot->storage, tuple, tuple->t_len);
+    slot->tuple = slot->storage;
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 用id和data在槽自己的存储中构造一个元组 */
+int tuple_slot_store(TupleSlot *slot, int id, const char *data) {
+    // 参数检查
+    if (!slot || !data) {
+        tuplestore_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    size_t data_len = strlen(data) + 1;
+    if (data_len > UINT32_MAX - TUPLE_HEADER_SIZE - TUPLE_ALIGNOF) {
+        tuplestore_error("元组数据过长");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    uint32_t t_len = (uint32_t)(TUPLE_HEADER_SIZE + data_len);
+    
+    int result = tuple_slot_reserve(slot, TUPLE_ALIGN(t_len));
+    if (result != TUPLESTORE_SUCCESS) {
+        return result;
+    }
+    tuplestore_fill_tuple(slot->storage, t_len, id, data);
+    slot->tuple = slot->storage;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 将下一个元组放入槽中（参照PostgreSQL的tuplestore_gettupleslot）
+ *
+ * copy为0时槽借用存储中的元组，有效期同tuplestore_get_next_borrowed；
+ * copy非0时元组被复制到槽自己的存储中，该存储只在元组变大时才重新分配，
+ * 在下一次放入元组或tuple_slot_release之前一直有效。
+ * 返回1表示取到元组，0表示没有更多元组，负值为错误码。
+ */
+int tuplestore_gettupleslot(TupleStore *store, int copy, TupleSlot *slot) {
+    // 参数检查
+    if (!store || !slot) {
+        tuplestore_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    Tuple *tuple;
+    int result = tuplestore_fetch_next(store, &tuple);
+    if (result <= 0) {
+        slot->tuple = NULL;
+        return result;
+    }
+    
+    if (!copy) {
+        slot->tuple = tuple;
+        return 1;
+    }
+    
+    result = tuple_slot_copy(slot, tuple);
+    return result == TUPLESTORE_SUCCESS ? 1 : result;
+}
+
+/* 重置读取位置 */
+int tuplestore_rescan(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 不支持rescan的读指针可能已经被裁剪掉前面的元组
+    if (!(store->readptrs[store->activeptr].eflags & TUPLESTORE_EFLAG_REWIND)) {
+        tuplestore_error("当前读指针不支持重新扫描");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 如果缓冲区处于写入模式且有数据，先刷新
+    if (store->using_file && store->buffer_write_mode == BUFFER_MODE_WRITE && store->buffer_count > 0) {
+        int result = tuplestore_flush_buffer(store);
+        if (result != TUPLESTORE_SUCCESS) {
+            tuplestore_error("重置前刷新缓冲区失败");
+            return result;
+        }
+    }
+    
+    // 重置读取位置
+    store->read_pos = 0;
+    
+    // 如果使用文件，重置文件指针
+    if (store->using_file && store->temp_file) {
+        if (fseek(store->temp_file, 0, SEEK_SET) != 0) {
+            tuplestore_error("重置文件指针失败");
+            return TUPLESTORE_ERROR_IO;
+        }
+    }
+    
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 设置写缓冲区大小（字节）
+ *
+ * 默认从TUPLESTORE_WRITE_BLOCK_INIT开始，持续溢出时每次翻倍直到
+ * TUPLESTORE_WRITE_BLOCK_MAX；设置后固定使用bytes，不再自动增长。
+ * 压缩模式按TUPLESTORE_COMPRESS_BLOCK_SIZE分块，不受影响。
+ */
+int tuplestore_set_write_buffer_size(TupleStore *store, size_t bytes) {
+    if (!store || bytes == 0) {
+        tuplestore_error("无效的写缓冲区大小");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->write_block_bytes = bytes;
+    store->write_block_max = bytes;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 设置每次从文件读取的块大小（字节）
+ *
+ * 一个块内放得下的完整元组会被一次读入缓冲区；单个元组超过块大小时
+ * 单独读取。较大的块减少读取次数，但每个读指针的缓冲区也会更大。
+ */
+int tuplestore_set_read_block_size(TupleStore *store, size_t bytes) {
+    if (!store || bytes == 0) {
+        tuplestore_error("无效的读取块大小");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->read_block_bytes = bytes;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 开启或关闭预读
+ *
+ * 开启时每读入一个块，就用posix_fadvise(POSIX_FADV_WILLNEED)让内核在
+ * 后台读取下一个块，扫描溢出的数据时不必在每次填充缓冲区时等待磁盘。
+ */
+int tuplestore_set_readahead(TupleStore *store, int enable) {
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->readahead = enable ? 1 : 0;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 开启或关闭内存映射读取模式
+ *
+ * 开启后，读取溢出的元组时把临时文件只读映射到内存，零拷贝接口直接返回
+ * 映射中的元组，省去fread到缓冲区的复制，由内核页缓存负责缓冲。
+ * 适合需要多次重新扫描的物化结果。
+ */
+int tuplestore_set_mmap(TupleStore *store, int enable) {
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (enable && tuplestore_uses_blocks(store)) {
+        tuplestore_error("压缩或分列存放的临时文件不能通过内存映射直接读取");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->use_mmap = enable ? 1 : 0;
+    if (!store->use_mmap) {
+        tuplestore_unmap_file(store);
+    }
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 设置临时文件的压缩方式
+ *
+ * 必须在溢出到文件之前调用。压缩模式下写缓冲区按TUPLESTORE_COMPRESS_BLOCK_SIZE
+ * 字节成块压缩，压缩后不变小的块原样存储；块目录保证仍然可以定位任意元组。
+ * 与内存映射模式互斥。
+ */
+int tuplestore_set_compression(TupleStore *store, int compression) {
+    if (!store || store->temp_file ||
+        (compression != TUPLESTORE_COMPRESS_NONE && compression != TUPLESTORE_COMPRESS_LZ4)) {
+        tuplestore_error("无法设置压缩方式");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (compression != TUPLESTORE_COMPRESS_NONE && store->use_mmap) {
+        tuplestore_error("内存映射模式不支持压缩");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (compression != TUPLESTORE_COMPRESS_NONE && store->layout != TUPLESTORE_LAYOUT_ROW) {
+        tuplestore_error("分列存放的临时文件不支持压缩");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->compression = compression;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 设置临时文件中元组的存放格式
+ *
+ * 必须在溢出到文件之前调用。PAX格式下每次刷新写缓冲区写入一个块，
+ * 块内先存放所有元组的id列，再存放data列；配合tuplestore_set_projection，
+ * 只需要id的扫描只读取每个块的id列。与压缩和内存映射模式互斥。
+ */
+int tuplestore_set_layout(TupleStore *store, int layout) {
+    if (!store || store->temp_file ||
+        (layout != TUPLESTORE_LAYOUT_ROW && layout != TUPLESTORE_LAYOUT_PAX)) {
+        tuplestore_error("无法设置存放格式");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (layout == TUPLESTORE_LAYOUT_PAX &&
+        (store->use_mmap || store->compression != TUPLESTORE_COMPRESS_NONE)) {
+        tuplestore_error("分列存放不支持压缩和内存映射模式");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->layout = layout;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 设置读取时需要的列（TUPLESTORE_COLUMN_*的组合）
+ *
+ * 不包含TUPLESTORE_COLUMN_DATA时，从PAX格式的临时文件读出的元组data为空串，
+ * 只有id有效；内存中的元组和按行存放的文件不受影响。投影改变后所有读指针
+ * 的文件缓冲区作废，下一次读取时按新的投影重新填充。
+ */
+int tuplestore_set_projection(TupleStore *store, int columns) {
+    if (!store || columns == 0 || (columns & ~TUPLESTORE_COLUMN_ALL) != 0) {
+        tuplestore_error("无效的投影列");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (columns == store->projection) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    // 写缓冲区中的元组先写入文件，缓冲区才能作为读缓冲区作废
+    if (store->buffer_write_mode == BUFFER_MODE_WRITE) {
+        int result = tuplestore_flush_buffer(store);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        store->buffer_write_mode = BUFFER_MODE_READ;
+        store->buffer_used = 0;
+    }
+    store->buffer_count = 0;
+    for (int i = 0; i < store->readptrcount; i++) {
+        store->readptrs[i].buffer_count = 0;
+    }
+    
+    store->projection = columns;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 设置读指针0的能力标志
+ *
+ * 只能在分配其他读指针之前调用。不带TUPLESTORE_EFLAG_REWIND时，
+ * tuplestore_trim可以丢弃已经读过的元组。
+ */
+int tuplestore_set_eflags(TupleStore *store, int eflags) {
+    if (!store || store->readptrcount != 1) {
+        tuplestore_error("只能在分配读指针之前设置能力标志");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    store->readptrs[0].eflags = eflags;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 分配一个新的读指针，返回读指针编号（负值为错误码）
+ *
+ * 新读指针从读指针0当前的位置开始，拥有自己的文件缓冲区。
+ */
+int tuplestore_alloc_read_pointer(TupleStore *store, int eflags) {
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    if (store->readptrcount >= store->readptrsize) {
+        int new_size = store->readptrsize * 2;
+        TSReadPointer *new_ptrs = (TSReadPointer*)realloc(store->readptrs,
+                                                          sizeof(TSReadPointer) * new_size);
+        if (!new_ptrs) {
+            tuplestore_error("无法为读指针分配内存");
+            return TUPLESTORE_ERROR_MEMORY;
+        }
+        store->readptrs = new_ptrs;
+        store->readptrsize = new_size;
+    }
+    
+    TSReadPointer *ptr = &store->readptrs[store->readptrcount];
+    ptr->eflags = eflags;
+    ptr->read_pos = store->activeptr == 0 ? store->read_pos : store->readptrs[0].read_pos;
+    ptr->mark_pos = -1;
+    ptr->buffer_bytes = TUPLESTORE_INITIAL_BUFFER_BYTES;
+    ptr->buffer_offset = 0;
+    ptr->buffer_start = 0;
+    ptr->buffer_count = 0;
+    ptr->buffer = (char*)malloc(ptr->buffer_bytes);
+    if (!ptr->buffer) {
+        tuplestore_error("无法为读指针缓冲区分配内存");
+        return TUPLESTORE_ERROR_MEMORY;
+    }
+    
+    return store->readptrcount++;
+}
+
+/*
+ * 切换当前活动的读指针
+ *
+ * 把活动状态写回原读指针，再载入新读指针的状态。缓冲区中还有未写入
+ * 文件的元组时先刷新，因为缓冲区属于原读指针。
+ */
+int tuplestore_select_read_pointer(TupleStore *store, int ptr) {
+    if (!store || ptr < 0 || ptr >= store->readptrcount) {
+        tuplestore_error("无效的读指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    if (ptr == store->activeptr) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    if (store->buffer_write_mode == BUFFER_MODE_WRITE) {
+        int result = tuplestore_flush_buffer(store);
+        if (result != TUPLESTORE_SUCCESS) {
+            return result;
+        }
+        store->buffer_write_mode = BUFFER_MODE_READ;
+        store->buffer_count = 0;
+        store->buffer_used = 0;
+    }
+    
+    TSReadPointer *old = &store->readptrs[store->activeptr];
+    old->read_pos = store->read_pos;
+    old->buffer = store->buffer;
+    old->buffer_bytes = store->buffer_bytes;
+    old->buffer_offset = store->buffer_offset;
+    old->buffer_start = store->buffer_start;
+    old->buffer_count = store->buffer_count;
+    
+    TSReadPointer *new_ptr = &store->readptrs[ptr];
+    store->read_pos = new_ptr->read_pos;
+    store->buffer = new_ptr->buffer;
+    store->buffer_bytes = new_ptr->buffer_bytes;
+    store->buffer_offset = new_ptr->buffer_offset;
+    store->buffer_start = new_ptr->buffer_start;
+    store->buffer_count = new_ptr->buffer_count;
+    new_ptr->buffer = NULL;  // 缓冲区现在由活动状态持有
+    
+    store->activeptr = ptr;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 丢弃所有读指针都已经读过的元组（参照PostgreSQL的tuplestore_trim）
+ *
+ * 只要有一个读指针需要rescan或向后读取就不能裁剪；读指针的标记位置之后的
+ * 元组也会保留。内存中的元组所在的内存块被整体
+ * 释放；已写入文件的元组从偏移索引中移除，并在支持的平台上释放临时文件
+ * 中对应的磁盘空间。所有位置随之前移，调用者看到的元组序列不变。
+ * 为避免每次都移动数组，要丢弃的元组不足总数的1/8时什么也不做。
+ */
+int tuplestore_trim(TupleStore *store) {
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    // 找出最靠前的读指针或标记位置
+    int oldest = store->read_pos;
+    for (int i = 0; i < store->readptrcount; i++) {
+        TSReadPointer *ptr = &store->readptrs[i];
+        if (ptr->eflags & (TUPLESTORE_EFLAG_REWIND | TUPLESTORE_EFLAG_BACKWARD)) {
+            return TUPLESTORE_SUCCESS;
+        }
+        if (i != store->activeptr && ptr->read_pos < oldest) {
+            oldest = ptr->read_pos;
+        }
+        if (ptr->mark_pos >= 0 && ptr->mark_pos < oldest) {
+            oldest = ptr->mark_pos;
+        }
+    }
+    
+    int total = store->using_file ? store->file_count : store->count;
+    int nremove = oldest;
+    if (nremove <= 0 || nremove < total / 8) {
+        return TUPLESTORE_SUCCESS;
+    }
+    
+    if (!store->using_file) {
+        // 释放只包含已丢弃元组的内存块，并移动指针数组
+        if (nremove < store->count) {
+            tuplestore_chunk_release_before(store, store->tuples[nremove]);
+        } else {
+            tuplestore_chunk_release(store);
+        }
+        memmove(store->tuples, store->tuples + nremove,
+                sizeof(Tuple*) * (store->count - nremove));
+        store->count -= nremove;
+    } else {
+        // 写缓冲区中的元组也有偏移索引，先写入文件简化处理
+        if (store->buffer_write_mode == BUFFER_MODE_WRITE) {
+            int result = tuplestore_flush_buffer(store);
+            if (result != TUPLESTORE_SUCCESS) {
+                return result;
+            }
+        }
+        
+        long keep_from = tuplestore_file_offset(store, nremove);
+        
+        // 按块组织的文件：丢弃已经完全被裁剪的块，其余块的元组位置前移
+        if (tuplestore_uses_blocks(store)) {
+            int drop = 0;
+            while (drop < store->block_count &&
+                   store->blocks[drop].first_tuple + store->blocks[drop].ntuples <= nremove) {
+                drop++;
+            }
+            memmove(store->blocks, store->blocks + drop,
+                    sizeof(TupleStoreBlock) * (store->block_count - drop));
+            store->block_count -= drop;
+            for (int i = 0; i < store->block_count; i++) {
+                store->blocks[i].first_tuple -= nremove;
+            }
+            keep_from = store->block_count > 0 ? store->blocks[0].file_offset
+                                               : store->file_physical_size;
+        }
+#ifdef FALLOC_FL_PUNCH_HOLE
+        // 释放已丢弃元组占用的磁盘空间，文件大小和偏移保持不变
+        long punch = keep_from / TUPLESTORE_TRIM_PAGE_SIZE * TUPLESTORE_TRIM_PAGE_SIZE;
+        if (punch > 0 &&
+            fallocate(fileno(store->temp_file), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      0, punch) != 0 && errno != EOPNOTSUPP) {
+            tuplestore_error("释放临时文件空间失败");
+        }
+#endif
+        (void)keep_from;
+        
+        memmove(store->file_offsets, store->file_offsets + nremove,
+                sizeof(long) * (store->file_count - nremove));
+        store->file_count -= nremove;
+    }
+    
+    // 所有读指针的位置前移；缓冲区起点已被丢弃的缓冲区作废
+    store->read_pos -= nremove;
+    store->buffer_start -= nremove;
+    if (store->buffer_start < 0) {
+        store->buffer_start = 0;
+        store->buffer_count = 0;
+    }
+    for (int i = 0; i < store->readptrcount; i++) {
+        TSReadPointer *ptr = &store->readptrs[i];
+        if (ptr->mark_pos >= 0) {
+            ptr->mark_pos -= nremove;
+        }
+        if (i == store->activeptr) {
+            continue;
+        }
+        ptr->read_pos -= nremove;
+        ptr->buffer_start -= nremove;
+        if (ptr->buffer_start < 0) {
+            ptr->buffer_start = 0;
+            ptr->buffer_count = 0;
+        }
+    }
+    
+    return TUPLESTORE_SUCCESS;
+}
+
+/* 获取溢出和I/O统计 */
+int tuplestore_get_stats(TupleStore *store, TupleStoreStats *stats) {
+    if (!store || !stats) {
+        tuplestore_error("无效的参数");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    *stats = store->stats;
+    return TUPLESTORE_SUCCESS;
+}
+
+/*
+ * 以EXPLAIN ANALYZE的风格输出存储方式和统计
+ *
+ * 第一行参照PostgreSQL的"Storage: Disk  Maximum Storage: NkB"，
+ * 溢出到文件后再输出转储、写入和读取各一行。
+ */
+void tuplestore_explain(TupleStore *store, FILE *out) {
+    if (!store || !out) {
+        return;
+    }
+    
+    const TupleStoreStats *stats = &store->stats;
+    if (!store->using_file) {
+        fprintf(out, "存储: 内存  最大内存: %dkB\n", (stats->peak_memory + 1023) / 1024);
+        return;
+    }
+    
+    fprintf(out, "存储: 磁盘  最大内存: %dkB  临时文件: %ldkB\n",
+            (stats->peak_memory + 1023) / 1024, (store->file_physical_size + 1023) / 1024);
+    fprintf(out, "  转储: %d 次, %ld 个元组, %.3f ms\n",
+            stats->spill_count, stats->spilled_tuples, stats->spill_ns / 1e6);
+    fprintf(out, "  写入: %ld 字节, %ld 次, %.3f ms\n",
+            stats->bytes_written, stats->write_calls, stats->write_ns / 1e6);
+    fprintf(out, "  读取: %ld 字节, %ld 次填充, %ld 次定位, %.3f ms\n",
+            stats->bytes_read, stats->buffer_refills, stats->seeks, stats->read_ns / 1e6);
+}
+
+/* 释放元组存储 */
+int tuplestore_free(TupleStore *store) {
+    // 参数检查
+    if (!store) {
+        tuplestore_error("无效的TupleStore指针");
+        return TUPLESTORE_ERROR_INVALID_PARAM;
+    }
+    
+    int error_occurred = 0;
+    
+    // 如果缓冲区处于写入模式且有数据，尝试刷新到文件
+    if (store->using_file && store->buffer_write_mode == BUFFER_MODE_WRITE && store->buffer_count > 0) {
+        if (tuplestore_flush_buffer(store) != TUPLESTORE_SUCCESS) {
+            tuplestore_error("释放前刷新缓冲区失败");
+            error_occurred = 1;
+            // 继续释放内存，即使刷新失败
+        }
+    }
+    
+    // 释放内存中的元组（整体释放内存块）
+    tuplestore_chunk_release(store);
+    if (store->tuples) {
+        free(store->tuples);
+        store->tuples = NULL;
+        store->count = 0;
+        store->capacity = 0;
+    }
+    
+    // 释放缓冲区中的元组
+    if (store->buffer) {
+        // 释放缓冲区连续内存块
+        free(store->buffer);
+        store->buffer = NULL;
+        store->buffer_count = 0;
+        store->buffer_bytes = 0;
+    }
+    
+    // 释放其他读指针的缓冲区（活动读指针的缓冲区已在上面释放）
+    if (store->readptrs) {
+        for (int i = 0; i < store->readptrcount; i++) {
+            if (i != store->activeptr) {
+                free(store->readptrs[i].buffer);
+            }
+        }
+        free(store->readptrs);
+        store->readptrs = NULL;
+        store->readptrcount = 0;
+    }
+    
+    // 释放块目录和压缩临时空间
+    free(store->blocks);
+    store->blocks = NULL;
+    store->block_count = 0;
+    free(store->compress_buffer);
+    store->compress_buffer = NULL;
+    
+    // 释放文件偏移索引
+    if (store->file_offsets) {
+        free(store->file_offsets);
+        store->file_offsets = NULL;
+        store->offsets_capacity = 0;
+    }
+    
+    // 解除映射并关闭临时文件
+    tuplestore_unmap_file(store);
+    if (store->temp_file) {
+        if (fclose(store->temp_file) != 0) {
+            tuplestore_error("关闭临时文件失败");
+            error_occurred = 1;
+        }
+        store->temp_file = NULL;
+    }
+    
+    // 删除临时文件
+    if (store->filename) {
+        if (unlink(store->filename) != 0 && errno != ENOENT) {
+            // ENOENT表示文件不存在，这不是错误
+            tuplestore_error("删除临时文件失败");
+            error_occurred = 1;
+        }
+        free(store->filename);
+        store->filename = NULL;
+    }
+    
+    // 重置内存计数器
+    store->current_memory = 0;
+    store->max_memory_kb = 0;
+    
+    // 释放存储结构
+    free(store);
+    
+    return error_occurred ? TUPLESTORE_ERROR_CLEANUP : TUPLESTORE_SUCCESS;
+}
@@ -0,0 +1,308 @@
+#ifndef TUPLESTORE_H
+#define TUPLESTORE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * TupleStore - 一个简单的元组存储实现
+ * 支持内存和磁盘存储，自动溢出到磁盘
+ */
+
+/* 缓冲区模式 */
+typedef enum {
+    BUFFER_MODE_READ = 0,
+    BUFFER_MODE_WRITE = 1
+} BufferMode;
+
+/* 临时文件压缩方式 */
+typedef enum {
+    TUPLESTORE_COMPRESS_NONE = 0,  /* 不压缩 */
+    TUPLESTORE_COMPRESS_LZ4 = 1    /* LZ4块格式；没有liblz4时使用内置实现 */
+} TupleStoreCompression;
+
+/* 临时文件中元组的存放格式 */
+typedef enum {
+    TUPLESTORE_LAYOUT_ROW = 0,     /* 按行存放，与内存中的元组格式相同 */
+    TUPLESTORE_LAYOUT_PAX = 1      /* 按块分列存放（PAX），每块先存id列再存data列 */
+} TupleStoreLayout;
+
+/* 读取时需要的列（投影），PAX格式下没有请求的列不从文件读取 */
+#define TUPLESTORE_COLUMN_ID 0x01
+#define TUPLESTORE_COLUMN_DATA 0x02
+#define TUPLESTORE_COLUMN_ALL (TUPLESTORE_COLUMN_ID | TUPLESTORE_COLUMN_DATA)
+
+/* 读指针能力标志 */
+#define TUPLESTORE_EFLAG_REWIND 0x01       /* 读指针需要支持tuplestore_rescan */
+#define TUPLESTORE_EFLAG_BACKWARD 0x02     /* 读指针需要支持向后读取 */
+
+/* 错误码 */
+typedef enum {
+    TUPLESTORE_SUCCESS = 0,
+    TUPLESTORE_ERROR_MEMORY = -1,
+    TUPLESTORE_ERROR_IO = -2,
+    TUPLESTORE_ERROR_INVALID_PARAM = -3,
+    TUPLESTORE_ERROR_INTERNAL = -4,
+    TUPLESTORE_ERROR_CLEANUP = -5
+} TupleStoreError;
+
+/*
+ * 定义元组结构（变长格式）
+ *
+ * t_len是长度前缀，记录整个元组（头部 + 数据 + 结尾'\0'）的字节数。
+ * 元组在内存、缓冲区和临时文件中使用同一种格式，每个元组实际占用
+ * TUPLE_ALIGN(t_len)字节，短元组不再固定占用104字节。
+ */
+typedef struct {
+    uint32_t t_len;      /* 元组总长度（字节） */
+    int id;
+    char data[];         /* 变长数据，以'\0'结尾 */
+} Tuple;
+
+/* 元组头部大小 */
+#define TUPLE_HEADER_SIZE offsetof(Tuple, data)
+
+/* 元组按头部字段对齐，保证在缓冲区中连续存放时可以直接访问 */
+#define TUPLE_ALIGNOF sizeof(uint32_t)
+#define TUPLE_ALIGN(len) (((size_t)(len) + TUPLE_ALIGNOF - 1) & ~(TUPLE_ALIGNOF - 1))
+
+/*
+ * 元组内存块
+ *
+ * 内存中的元组从块中顺序分配（bump allocation），不再逐个malloc/free；
+ * 转储到文件或释放存储时整个块一起释放。块按分配顺序链接。
+ */
+typedef struct TupleChunk {
+    struct TupleChunk *next; /* 下一个（更晚分配的）块 */
+    size_t size;         /* 整个块的大小（含块头） */
+    size_t used;         /* 已使用的字节数（含块头） */
+    char data[];         /* 元组数据区 */
+} TupleChunk;
+
+/*
+ * 块目录项
+ *
+ * 压缩模式和PAX格式下临时文件由若干块组成，每块保存一段连续的完整元组。
+ * 偏移索引记录的是元组在按行存放的数据流中的（逻辑）偏移，块目录把逻辑
+ * 范围映射到文件中的实际位置，因此仍然可以定位到任意元组。
+ */
+typedef struct {
+    int first_tuple;     /* 块中第一个元组的位置 */
+    int ntuples;         /* 块中的元组数量 */
+    long logical_offset; /* 块数据在未压缩数据流中的偏移 */
+    long file_offset;    /* 块在临时文件中的偏移 */
+    uint32_t raw_len;    /* 未压缩的字节数 */
+    uint32_t stored_len; /* 文件中存储的字节数，压缩模式下等于raw_len表示未压缩 */
+} TupleStoreBlock;
+
+/*
+ * 读指针（参照PostgreSQL的TSReadPointer）
+ *
+ * 每个读指针有自己的读取位置和文件缓冲区。当前活动读指针的状态保存在
+ * TupleStore的read_pos/buffer等字段中，切换读指针时才写回这里。
+ * mark_pos不随切换移动，总是保存在这里。
+ */
+typedef struct {
+    int eflags;          /* 能力标志（TUPLESTORE_EFLAG_*） */
+    int read_pos;        /* 读取位置 */
+    int mark_pos;        /* tuplestore_markpos记住的位置，-1表示没有 */
+    char *buffer;        /* 该读指针的文件缓冲区 */
+    size_t buffer_bytes; /* 缓冲区容量（字节） */
+    long buffer_offset;  /* 缓冲区数据在未压缩数据流中的偏移 */
+    int buffer_start;    /* 缓冲区中第一个元组在文件中的位置 */
+    int buffer_count;    /* 缓冲区中的元组数量 */
+} TSReadPointer;
+
+/*
+ * 溢出和I/O统计
+ *
+ * 计数在每次转储、刷新写缓冲区和填充读缓冲区时累加，计时只包在这些
+ * 系统调用前后（每次两次clock_gettime），逐个元组的操作不计时，
+ * 因此可以一直开启。内存映射模式下的读取由缺页完成，不计入读取统计。
+ */
+typedef struct {
+    int spill_count;         /* 从内存转储到文件的次数 */
+    long spilled_tuples;     /* 转储时写出的内存中元组数 */
+    uint64_t spill_ns;       /* 转储花费的时间（纳秒，含写出） */
+    long bytes_written;      /* 写入临时文件的字节数（压缩后） */
+    long write_calls;        /* 刷新写缓冲区的次数 */
+    uint64_t write_ns;       /* 写入临时文件花费的时间（纳秒） */
+    long bytes_read;         /* 从临时文件读取的字节数 */
+    long buffer_refills;     /* 填充读缓冲区的次数 */
+    long seeks;              /* 不从上一次读取结束处开始的读取次数 */
+    uint64_t read_ns;        /* 读取临时文件花费的时间（纳秒） */
+    int peak_memory;         /* current_memory的峰值（字节） */
+} TupleStoreStats;
+
+/* 内存中的元组存储 */
+typedef struct {
+    Tuple **tuples;      /* 元组指针数组，指向内存块中的元组 */
+    int capacity;        /* 数组容量 */
+    int count;           /* 当前元组数量 */
+    int read_pos;        /* 当前读取位置 */
+    int max_memory_kb;   /* 最大内存限制(KB) */
+    int current_memory;  /* 当前使用的内存(bytes) */
+    TupleChunk *chunk_head; /* 最早分配的元组内存块 */
+    TupleChunk *chunk_tail; /* 当前用于分配的元组内存块 */
+    size_t next_chunk_size; /* 下一个内存块的大小 */
+    FILE *temp_file;     /* 临时文件，当内存不足时使用 */
+    int using_file;      /* 是否正在使用文件 */
+    int file_count;      /* 文件中的元组数量 */
+    char *filename;      /* 临时文件名 */
+    
+    /* 文件偏移索引，用于在变长元组中随机定位 */
+    long *file_offsets;  /* 第i个元组在文件中的起始偏移 */
+    int offsets_capacity; /* 偏移索引容量 */
+    long file_size;      /* 已写入文件的元组的总字节数（未压缩） */
+    long file_physical_size; /* 临时文件的实际字节数 */
+    
+    /* 块压缩 */
+    int compression;     /* 压缩方式（TupleStoreCompression） */
+    TupleStoreBlock *blocks; /* 块目录 */
+    int block_count;     /* 块数量 */
+    int block_capacity;  /* 块目录容量 */
+    char *compress_buffer; /* 压缩/解压和PAX格式转换用的临时空间 */
+    size_t compress_buffer_bytes; /* 临时空间容量 */
+    
+    /* 分列存放 */
+    int layout;          /* 临时文件格式（TupleStoreLayout） */
+    int projection;      /* 读取时需要的列（TUPLESTORE_COLUMN_*） */
+    
+    /* 文件缓冲区相关 */
+    char *buffer;        /* 连续内存块，按变长格式存放元组 */
+    size_t buffer_bytes; /* 缓冲区容量（字节） */
+    size_t buffer_used;  /* 缓冲区中已使用的字节数（写入模式） */
+    size_t write_block_bytes; /* 写缓冲区积累到多少字节后写入文件 */
+    size_t write_block_max; /* write_block_bytes自动增长的上限 */
+    size_t read_block_bytes; /* 每次从文件读取的块大小（字节） */
+    int readahead;       /* 是否预读下一个块 */
+    
+    /* 内存映射读取模式 */
+    int use_mmap;        /* 是否通过mmap读取临时文件 */
+    char *map_base;      /* 临时文件的只读映射 */
+    size_t map_size;     /* 映射的字节数（可以超过文件大小） */
+    size_t map_valid;    /* 映射中已确认对读取可见的字节数 */
+    long buffer_offset;  /* 缓冲区数据在未压缩数据流中的偏移（读取模式） */
+    int buffer_start;    /* 缓冲区中第一个元组在文件中的位置（读取模式） */
+    int buffer_count;    /* 缓冲区中当前的元组数量 */
+    int buffer_write_mode; /* 缓冲区模式（0=读取，1=写入） */
+    
+    /* 读指针 */
+    TSReadPointer *readptrs; /* 读指针数组 */
+    int readptrcount;    /* 读指针数量 */
+    int readptrsize;     /* 读指针数组容量 */
+    int activeptr;       /* 当前活动的读指针 */
+    
+    /* 统计 */
+    TupleStoreStats stats; /* 溢出和I/O统计 */
+    long read_end;       /* 上一次读取结束的文件偏移，用于统计定位次数 */
+} TupleStore;
+
+/* 元组槽，用于在扫描中反复接收元组而不必逐个分配内存 */
+typedef struct {
+    const Tuple *tuple;  /* 当前元组，NULL表示没有元组 */
+    Tuple *storage;      /* 槽自己的存储（复制模式使用） */
+    size_t storage_size; /* 存储的字节数 */
+} TupleSlot;
+
+/* 创建元组存储 */
+TupleStore* tuplestore_create(int max_memory_kb);
+
+/* 添加元组到存储中 */
+int tuplestore_put(TupleStore *store, int id, const char *data);
+
+/* 批量添加n个元组，ids[i]和data[i]组成第i个元组 */
+int tuplestore_put_batch(TupleStore *store, const int *ids, const char *const *data, int n);
+
+/* 将缓冲区中的元组刷新到文件（写入模式） */
+int tuplestore_flush_buffer(TupleStore *store);
+
+/* 将内存中的元组转储到文件 */
+int tuplestore_dump_to_file(TupleStore *store);
+
+/* 从文件中读取数据到缓冲区 */
+int tuplestore_fill_buffer(TupleStore *store);
+
+/* 从存储中获取下一个元组（副本，调用者释放） */
+Tuple* tuplestore_get_next(TupleStore *store);
+
+/* 以零拷贝方式获取下一个元组 */
+const Tuple* tuplestore_get_next_borrowed(TupleStore *store);
+
+/* 以零拷贝方式获取上一个元组 */
+const Tuple* tuplestore_get_prev_borrowed(TupleStore *store);
+
+/* 以零拷贝方式获取最多max个元组，返回取到的元组数 */
+int tuplestore_get_batch(TupleStore *store, const Tuple **tuples, int max);
+
+/* 把读取位置移动n个元组（n为负时向后移动） */
+int tuplestore_advance(TupleStore *store, int n);
+
+/* 记住当前读取位置 */
+int tuplestore_markpos(TupleStore *store);
+
+/* 回到记住的读取位置 */
+int tuplestore_restorepos(TupleStore *store);
+
+/* 将下一个元组放入槽中 */
+int tuplestore_gettupleslot(TupleStore *store, int copy, TupleSlot *slot);
+
+/* 初始化元组槽 */
+void tuple_slot_init(TupleSlot *slot);
+
+/* 释放元组槽自己持有的存储 */
+void tuple_slot_release(TupleSlot *slot);
+
+/* 将元组复制到槽自己的存储中 */
+int tuple_slot_copy(TupleSlot *slot, const Tuple *tuple);
+
+/* 用id和data在槽自己的存储中构造一个元组 */
+int tuple_slot_store(TupleSlot *slot, int id, const char *data);
+
+/* 重置读取位置 */
+int tuplestore_rescan(TupleStore *store);
+
+/* 设置写缓冲区大小（字节） */
+int tuplestore_set_write_buffer_size(TupleStore *store, size_t bytes);
+
+/* 设置每次从文件读取的块大小（字节） */
+int tuplestore_set_read_block_size(TupleStore *store, size_t bytes);
+
+/* 开启或关闭预读 */
+int tuplestore_set_readahead(TupleStore *store, int enable);
+
+/* 开启或关闭内存映射读取模式 */
+int tuplestore_set_mmap(TupleStore *store, int enable);
+
+/* 设置临时文件的压缩方式 */
+int tuplestore_set_compression(TupleStore *store, int compression);
+
+/* 设置临时文件中元组的存放格式 */
+int tuplestore_set_layout(TupleStore *store, int layout);
+
+/* 设置读取时需要的列 */
+int tuplestore_set_projection(TupleStore *store, int columns);
+
+/* 设置读指针0的能力标志 */
+int tuplestore_set_eflags(TupleStore *store, int eflags);
+
+/* 分配一个新的读指针 */
+int tuplestore_alloc_read_pointer(TupleStore *store, int eflags);
+
+/* 切换当前活动的读指针 */
+int tuplestore_select_read_pointer(TupleStore *store, int ptr);
+
+/* 丢弃所有读指针都已经读过的元组 */
+int tuplestore_trim(TupleStore *store);
+
+/* 获取溢出和I/O统计 */
+int tuplestore_get_stats(TupleStore *store, TupleStoreStats *stats);
+
+/* 以EXPLAIN ANALYZE的风格输出存储方式和统计 */
+void tuplestore_explain(TupleStore *store, FILE *out);
+
+/* 释放元组存储 */
+int tuplestore_free(TupleStore *store);
+
+#endif /* TUPLESTORE_H */
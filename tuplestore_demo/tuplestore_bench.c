@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "tuplestore.h"
+
+/**
+ * TupleStore基准测试 - 扫描溢出阈值和缓冲区大小
+ *
+ * 对每一组参数（元组数、元组宽度、内存限制、写缓冲区大小、重新扫描次数、
+ * 临时文件格式、扫描的列）在单独的子进程中运行一次，这样峰值RSS只反映
+ * 这一组参数。结果以CSV输出：
+ *
+ *   ./tuplestore_bench [-n 元组数列表] [-w 宽度列表] [-m 内存限制KB列表]
+ *                      [-b 写缓冲区字节数列表] [-r 重新扫描次数列表]
+ *                      [-l 格式列表(0=行,1=PAX)] [-c 列列表(1=id,3=全部)]
+ *
+ * 列表用逗号分隔，例如 -n 10000,100000 -m 64,1024。
+ */
+
+#define BENCH_MAX_VALUES 16
+
+/* 一个参数的取值列表 */
+typedef struct {
+    const char *name;
+    long min;                  /* 允许的最小值 */
+    long values[BENCH_MAX_VALUES];
+    int count;
+} BenchParam;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* 解析逗号分隔的取值列表 */
+static int parse_list(BenchParam *param, const char *arg) {
+    char *copy = strdup(arg);
+    if (!copy) {
+        return -1;
+    }
+    param->count = 0;
+    for (char *tok = strtok(copy, ","); tok; tok = strtok(NULL, ",")) {
+        long value = strtol(tok, NULL, 10);
+        if (value < param->min || param->count >= BENCH_MAX_VALUES) {
+            free(copy);
+            return -1;
+        }
+        param->values[param->count++] = value;
+    }
+    free(copy);
+    return param->count > 0 ? 0 : -1;
+}
+
+/*
+ * 运行一组参数并输出一行CSV
+ *
+ * 写入阶段统计put吞吐量，读取阶段统计rescans次完整扫描的吞吐量。
+ * 字节数、填充和定位次数来自存储自己的统计（tuplestore_get_stats）。
+ */
+static int run_one(long ntuples, long width, long memory_kb, long write_buffer, long rescans,
+                   long layout, long columns) {
+    TupleStore *store = tuplestore_create((int)memory_kb);
+    if (!store) {
+        return 1;
+    }
+    tuplestore_set_write_buffer_size(store, (size_t)write_buffer);
+    if (tuplestore_set_layout(store, (int)layout) != TUPLESTORE_SUCCESS ||
+        tuplestore_set_projection(store, (int)columns) != TUPLESTORE_SUCCESS) {
+        tuplestore_free(store);
+        return 1;
+    }
+    
+    // 元组数据：width-1个字符加结尾的'\0'，开头写入序号避免数据完全相同
+    char *data = (char*)malloc(width);
+    if (!data) {
+        tuplestore_free(store);
+        return 1;
+    }
+    memset(data, 'x', width - 1);
+    data[width - 1] = '\0';
+    
+    double start = now_seconds();
+    for (long i = 0; i < ntuples; i++) {
+        char prefix[16];
+        int n = snprintf(prefix, sizeof(prefix), "%ld", i);
+        memcpy(data, prefix, n < width - 1 ? n : width - 1);
+        if (tuplestore_put(store, (int)i, data) != TUPLESTORE_SUCCESS) {
+            free(data);
+            tuplestore_free(store);
+            return 1;
+        }
+    }
+    // 写入阶段包括最后一次刷新，不同写块大小留在缓冲区中的数据量不同
+    if (tuplestore_flush_buffer(store) != TUPLESTORE_SUCCESS) {
+        free(data);
+        tuplestore_free(store);
+        return 1;
+    }
+    double put_seconds = now_seconds() - start;
+    TupleStoreStats put_stats;
+    tuplestore_get_stats(store, &put_stats);
+    
+    long scanned = 0;
+    long id_sum = 0;
+    start = now_seconds();
+    for (long r = 0; r < rescans; r++) {
+        tuplestore_rescan(store);
+        const Tuple *tuple;
+        while ((tuple = tuplestore_get_next_borrowed(store)) != NULL) {
+            id_sum += tuple->id;
+            scanned++;
+        }
+    }
+    double scan_seconds = now_seconds() - start;
+    TupleStoreStats scan_stats;
+    tuplestore_get_stats(store, &scan_stats);
+    
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    
+    if (scanned != ntuples * rescans) {
+        fprintf(stderr, "扫描到 %ld 个元组，期望 %ld\n", scanned, ntuples * rescans);
+        free(data);
+        tuplestore_free(store);
+        return 1;
+    }
+    
+    double mb = (double)ntuples * width / (1024.0 * 1024.0);
+    printf("%ld,%ld,%ld,%ld,%ld,%s,%ld,%s,%.0f,%.1f,%.0f,%.1f,%ld,%ld,%ld,%ld,%ld\n",
+           ntuples, width, memory_kb, write_buffer, rescans,
+           layout == TUPLESTORE_LAYOUT_PAX ? "pax" : "row", columns,
+           store->using_file ? "file" : "memory",
+           ntuples / put_seconds, mb / put_seconds,
+           scanned / scan_seconds, mb * rescans / scan_seconds,
+           put_stats.bytes_written,
+           scan_stats.bytes_read - put_stats.bytes_read,
+           scan_stats.buffer_refills - put_stats.buffer_refills,
+           scan_stats.seeks - put_stats.seeks,
+           usage.ru_maxrss);
+    fflush(stdout);
+    
+    free(data);
+    tuplestore_free(store);
+    (void)id_sum;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    BenchParam ntuples = {"元组数", 1, {10000, 100000}, 2};
+    BenchParam width = {"元组宽度", 2, {16, 128, 1024}, 3};
+    BenchParam memory = {"内存限制", 1, {64, 1024, 16384}, 3};
+    BenchParam buffer = {"写缓冲区", 1, {4096, 65536, 1048576}, 3};
+    BenchParam rescans = {"扫描次数", 1, {1, 3}, 2};
+    BenchParam layout = {"存放格式", TUPLESTORE_LAYOUT_ROW, {TUPLESTORE_LAYOUT_ROW}, 1};
+    BenchParam columns = {"扫描列", TUPLESTORE_COLUMN_ID, {TUPLESTORE_COLUMN_ALL}, 1};
+    
+    int opt;
+    while ((opt = getopt(argc, argv, "n:w:m:b:r:l:c:")) != -1) {
+        BenchParam *param;
+        switch (opt) {
+            case 'n': param = &ntuples; break;
+            case 'w': param = &width; break;
+            case 'm': param = &memory; break;
+            case 'b': param = &buffer; break;
+            case 'r': param = &rescans; break;
+            case 'l': param = &layout; break;
+            case 'c': param = &columns; break;
+            default:
+                fprintf(stderr, "用法: %s [-n 列表] [-w 列表] [-m 列表] [-b 列表] [-r 列表] [-l 列表] [-c 列表]\n", argv[0]);
+                return 1;
+        }
+        if (parse_list(param, optarg) != 0) {
+            fprintf(stderr, "无效的%s列表: %s\n", param->name, optarg);
+            return 1;
+        }
+    }
+    
+    printf("tuples,width,max_memory_kb,write_buffer_bytes,rescans,layout,columns,storage,"
+           "put_tuples_per_sec,put_mb_per_sec,scan_tuples_per_sec,scan_mb_per_sec,"
+           "bytes_written,bytes_read,buffer_refills,seeks,peak_rss_kb\n");
+    fflush(stdout);
+    
+    int failures = 0;
+    for (int a = 0; a < ntuples.count; a++)
+    for (int b = 0; b < width.count; b++)
+    for (int c = 0; c < memory.count; c++)
+    for (int d = 0; d < buffer.count; d++)
+    for (int e = 0; e < rescans.count; e++)
+    for (int f = 0; f < layout.count; f++)
+    for (int g = 0; g < columns.count; g++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            _exit(run_one(ntuples.values[a], width.values[b], memory.values[c],
+                          buffer.values[d], rescans.values[e],
+                          layout.values[f], columns.values[g]));
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failures++;
+        }
+    }
+    
+    return failures ? 1 : 0;
+}